@@ -10,6 +10,32 @@
 #include <deque>
 #include <mutex>
 #include <condition_variable>
+#include <chrono>
+#include <poll.h>
+#include <cstdint>
+#include <endian.h>
+#include <cstddef>
+#include <netinet/udp.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <memory>
+#include <fcntl.h>
+#include <climits>
+#include <sys/uio.h>
+#include <atomic>
+#include <algorithm>
+#include <linux/futex.h>
+#include <unordered_map>
+#include <sys/stat.h>
+#include <linux/filter.h>
+#include <linux/sock_diag.h>
+#include <pthread.h>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#include <immintrin.h>
+#endif
 
 volatile sig_atomic_t running = 1;
 
@@ -22,10 +48,154 @@ const int MAX_BUFFER_SIZE = 1024;
 const int MAX_PACKETS = 10000;
 const int TIMEOUT_SECONDS = 10;
 const int RECV_BUFFER_SIZE = 8192;
-const int MAX_QUEUE_SIZE = 1000;
+const int RCVBUF_DATAGRAM_COST = 2304;     // Receive buffer charge (skb truesize) of one full datagram
+const int GRO_RECV_BUFFER_SIZE = 4 << 20;  // Coalesced reads are up to 64 KB each
+const int GRO_BUFFER_SIZE = 65536;         // One read with UDP_GRO can hold a whole GSO message
+const off_t FALLOCATE_EXTENT = 64 << 20;   // Output file space is reserved this much at a time
+const off_t SYNC_BATCH_BYTES = 16 << 20;   // Start writeback after this much new output
+const unsigned URING_ENTRIES = 256;        // Submission queue depth of the io_uring backend
+const unsigned URING_CQ_FACTOR = 8;        // Completion queue size relative to it
+const unsigned URING_MIN_BUFFERS = 64;     // Provided receive buffers, at least
+const unsigned URING_SQPOLL_IDLE_MS = 1000;
+
+enum Backend {
+    BACKEND_SOCKET,     // recvmmsg() batches and sendto()
+    BACKEND_IO_URING    // Multishot recvmsg on provided buffers, ACKs as sendmsg SQEs
+};
+
+// How packets are spread over the shards of an SO_REUSEPORT group
+enum Steering {
+    STEER_HASH,         // The kernel's hash of the source address and port
+    STEER_CONN_ID       // cBPF program: connection id modulo the shard count
+};
+const int MAX_QUEUE_SIZE = 1024;           // Packets between the receive and processor threads
+const uint64_t SESSION_IDLE_US = 30000000;   // Sessions silent this long are closed
+const uint64_t SESSION_SWEEP_US = 1000000;   // How often idle sessions are looked for
+const int QUEUE_SPIN_ITERATIONS = 2000;    // Busy-polls before a queue wait falls back to a futex
+const int BENCH_QUEUE_PACKETS = 2000000;   // --bench-queue: packets in the throughput run
+const int BENCH_QUEUE_PACED = 100000;      // ...and in the paced latency run
+const uint64_t BENCH_QUEUE_INTERVAL_NS = 2000;  // ...one packet this often, too slow to build a backlog
+const int MIN_RECV_WINDOW = 64;          // One bitmap word
+const int MAX_RECV_WINDOW = 32768;       // Largest power of two the 16-bit window field holds
+
+// Command-line tunables, see print_usage()
+struct ReceiverOptions {
+    int ack_every = 4;              // ACK after this many in-order packets...
+    uint64_t ack_delay_us = 200;    // ...or once the oldest unacked packet is this old
+    int batch_size = 32;            // Datagrams pulled per recvmmsg() call
+    bool gro = false;               // Let the kernel coalesce datagrams (UDP_GRO)
+    Backend backend = BACKEND_SOCKET;
+    bool sqpoll = false;            // io_uring: kernel thread polls the submission queue
+    std::string output;             // Write received payloads to this file
+    int window = 1024;              // Reassembly window in packets, the most ACKs advertise
+    int shards = 1;                 // Receive threads, each with its own socket on the port
+    Steering steering = STEER_HASH;
+    bool verbose = true;            // Per-packet log lines
+};
+
+ReceiverOptions options;
 const char* LISTEN_IP = "192.168.0.109";
 using namespace std;
 
+// Wire format (shared with sender.cpp). Multi-byte fields are big-endian.
+const uint16_t PACKET_MAGIC = 0x5357;  // "SW"
+const uint8_t PROTOCOL_VERSION = 3;
+const uint8_t FLAG_DATA = 0x01;
+const uint8_t FLAG_ACK = 0x02;
+const uint8_t FLAG_FIN = 0x04;   // Set on the last data packet of a transfer
+const uint8_t FLAG_SYN = 0x08;   // Set on the first data packet of a session, fixes its base
+const uint8_t FLAG_REPAIR = 0x10;  // FEC repair packet: FecHeader and a coding symbol, never acked
+const uint8_t FLAG_FEC = 0x20;     // Data packet of a session that sends repair packets
+
+struct __attribute__((packed)) PacketHeader {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t flags;
+    uint32_t conn_id;
+    uint32_t seq_num;
+    uint16_t payload_len;
+    uint8_t checksum_type;
+    uint8_t attempt;      // Retransmission count, saturating at 255
+    uint32_t checksum;
+};
+
+const int MAX_SACK_WORDS = 16;  // SACK bitmap covers up to 1024 packets past cum_ack
+
+// Cumulative ACK plus a selective-ack bitmap. Bit i of the bitmap (word i / 64,
+// most significant bit first within the frame) means cum_ack + 1 + i arrived.
+// Only the leading non-zero words are sent.
+struct __attribute__((packed)) AckFrame {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t flags;
+    uint32_t conn_id;
+    uint32_t cum_ack;     // Every sequence number below this has arrived
+    uint16_t window;      // Packets the receiver can take past cum_ack right now
+    uint16_t sack_words;
+    uint32_t echo_seq;    // Latest data packet received, the one that prompted this ACK...
+    uint8_t echo_attempt; // ...and its attempt field, so the sender can time that transmission
+    uint8_t reserved[3];
+    uint64_t sack[MAX_SACK_WORDS];
+};
+
+const size_t ACK_BASE_SIZE = offsetof(AckFrame, sack);
+
+const size_t HEADER_SIZE = sizeof(PacketHeader);
+const size_t MAX_PAYLOAD_SIZE = MAX_BUFFER_SIZE - HEADER_SIZE;  // Also the file offset stride
+
+// Payload of a repair packet. Its seq_num is the first data packet of the
+// block it covers; the coding symbol follows the FecHeader.
+struct __attribute__((packed)) FecHeader {
+    uint8_t data_count;    // Data packets in the block
+    uint8_t repair_index;  // Row of fec_matrix this symbol was coded with
+    uint8_t repair_count;  // Repair packets sent for the block
+    uint8_t reserved;
+};
+
+// A data packet's coding symbol is its payload length (big-endian), its FIN
+// flag and a pad byte, then the payload, zero-padded to the longest symbol
+// of the block. A repair packet carries just that many bytes.
+const size_t FEC_SYMBOL_PREFIX = 4;
+const size_t FEC_SYMBOL_SIZE = FEC_SYMBOL_PREFIX + MAX_PAYLOAD_SIZE;
+const size_t REPAIR_PACKET_SIZE = HEADER_SIZE + sizeof(FecHeader) + FEC_SYMBOL_SIZE;
+const int FEC_MAX_DATA = 128;   // Data packets per block
+const int FEC_MAX_REPAIR = 16;  // Repair packets per block
+
+// A striped transfer runs one session per stripe. Their connection ids share
+// the upper 24 bits (the transfer id), bits 4-7 hold the stripe count minus
+// one and bits 0-3 the stripe index.
+inline uint32_t transfer_of(uint32_t conn_id) {
+    return conn_id >> 8;
+}
+
+inline int stripes_of(uint32_t conn_id) {
+    return ((conn_id >> 4) & 0xF) + 1;
+}
+
+// Serial-number arithmetic (RFC 1982) on 32-bit sequence numbers: a is
+// before b if it is less than half the sequence space behind it, so the
+// comparison keeps working after seq wraps around
+inline int32_t seq_diff(uint32_t a, uint32_t b) {
+    return static_cast<int32_t>(a - b);
+}
+
+inline bool seq_before(uint32_t a, uint32_t b) {
+    return seq_diff(a, b) < 0;
+}
+
+// Decoded data or repair packet. payload points into the receive buffer.
+struct PacketView {
+    uint32_t conn_id;
+    uint32_t seq_num;
+    const char* payload;
+    size_t payload_len;
+    bool fin;
+    bool syn;
+    bool repair;  // payload is a FecHeader and a coding symbol, seq_num its block
+    bool fec;     // The session sends repair packets
+    uint8_t attempt;  // Transmission of seq_num this is, 0 for the first
+};
+
 enum Protocol {
     STOP_AND_WAIT,
     GO_BACK_N,
@@ -36,17 +206,45 @@ struct ReceiverStats {
     int packets_received;
     int corrupted_packets;
     int out_of_order;
+    int out_of_window = 0;  // Beyond the reassembly window or ahead of the SYN, dropped
     size_t total_bytes_received;
+    int acks_sent;
+    uint64_t recv_syscalls = 0;
+    uint64_t datagrams_received = 0;  // Everything recvmmsg() returned, invalid packets included
+    int repair_packets = 0;           // FEC repair packets, used or not
+    int fec_recovered = 0;            // Data packets rebuilt from them
     
     ReceiverStats() : packets_received(0), corrupted_packets(0), 
-                      out_of_order(0), total_bytes_received(0) {}
+                      out_of_order(0), total_bytes_received(0), acks_sent(0) {}
+
+    void merge(const ReceiverStats& other) {
+        packets_received += other.packets_received;
+        corrupted_packets += other.corrupted_packets;
+        out_of_order += other.out_of_order;
+        out_of_window += other.out_of_window;
+        total_bytes_received += other.total_bytes_received;
+        acks_sent += other.acks_sent;
+        recv_syscalls += other.recv_syscalls;
+        datagrams_received += other.datagrams_received;
+        repair_packets += other.repair_packets;
+        fec_recovered += other.fec_recovered;
+    }
     
-    void print() {
-        cout << "\n=== Receiver Statistics ===\n"
+    void print(const string& title = "Receiver Statistics") {
+        cout << "\n=== " << title << " ===\n"
              << "Packets received: " << packets_received << "\n"
              << "Corrupted packets: " << corrupted_packets << "\n"
              << "Out of order packets: " << out_of_order << "\n"
-             << "Total bytes received: " << total_bytes_received << "\n";
+             << "Out of window packets: " << out_of_window << "\n"
+             << "Total bytes received: " << total_bytes_received << "\n"
+             << "ACKs sent: " << acks_sent << "\n"
+             << "Receive syscalls: " << recv_syscalls << " ("
+             << (recv_syscalls ? static_cast<double>(datagrams_received) / recv_syscalls : 0.0)
+             << " packets/call)\n";
+        if (repair_packets > 0) {
+            cout << "FEC repair packets: " << repair_packets << " (" << fec_recovered
+                 << " packets recovered)\n";
+        }
     }
 };
 
@@ -55,28 +253,306 @@ void handle_error(const string& msg) {
     exit(1);
 }
 
-bool validate_packet(const string& packet, int& seq_num, string& data) {
-    try {
-        size_t first_colon = packet.find(':');
-        size_t last_colon = packet.rfind(':');
-        
-        if (first_colon == string::npos || last_colon == string::npos || first_colon == last_colon) {
-            return false;
+// CRC32C (Castagnoli) integrity check. Every implementation below produces the
+// same value; the fastest one the CPU supports is picked at startup and its id
+// is recorded in PacketHeader::checksum_type.
+enum ChecksumType : uint8_t {
+    CHECKSUM_CRC32C_SW = 1,      // Slicing-by-8 tables
+    CHECKSUM_CRC32C_SSE42 = 2,   // SSE4.2 crc32 instruction
+    CHECKSUM_CRC32C_PCLMUL = 3   // Three crc32 lanes merged with PCLMULQDQ
+};
+
+const uint32_t CRC32C_POLY = 0x82F63B78;  // Reflected Castagnoli polynomial
+const size_t CRC_LANE_BYTES = 256;        // Per-lane stride of the PCLMUL variant
+
+typedef uint32_t (*Crc32cFn)(uint32_t crc, const unsigned char* data, size_t len);
+
+struct ChecksumEngine {
+    ChecksumType type;
+    const char* name;
+    Crc32cFn update;  // Raw register update, no pre/post inversion
+};
+
+uint32_t crc32c_table[8][256];
+uint64_t crc_lane_shift1, crc_lane_shift2;  // x^(8n-33) mod P for n = 1 and 2 lanes
+
+inline uint32_t load_le32(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t load_le64(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// x^n mod P in the reflected representation (bit 31 holds x^0)
+uint32_t crc32c_xpow(size_t n) {
+    uint32_t v = 0x80000000u;
+    while (n--) {
+        v = (v & 1) ? (v >> 1) ^ CRC32C_POLY : v >> 1;
+    }
+    return v;
+}
+
+uint32_t crc32c_sw(uint32_t crc, const unsigned char* p, size_t len) {
+    // Assumes a little-endian host
+    while (len >= 8) {
+        uint32_t a = crc ^ load_le32(p);
+        uint32_t b = load_le32(p + 4);
+        crc = crc32c_table[7][a & 0xff] ^ crc32c_table[6][(a >> 8) & 0xff] ^
+              crc32c_table[5][(a >> 16) & 0xff] ^ crc32c_table[4][a >> 24] ^
+              crc32c_table[3][b & 0xff] ^ crc32c_table[2][(b >> 8) & 0xff] ^
+              crc32c_table[1][(b >> 16) & 0xff] ^ crc32c_table[0][b >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p++) & 0xff];
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+uint32_t crc32c_sse42(uint32_t crc, const unsigned char* p, size_t len) {
+    uint64_t c = crc;
+    while (len >= 8) {
+        c = _mm_crc32_u64(c, load_le64(p));
+        p += 8;
+        len -= 8;
+    }
+    crc = static_cast<uint32_t>(c);
+    while (len--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+
+// Advances crc over (8n) zero bytes, given k = x^(8n-33) mod P
+__attribute__((target("sse4.2,pclmul")))
+inline uint32_t crc32c_shift(uint32_t crc, uint64_t k) {
+    __m128i prod = _mm_clmulepi64_si128(_mm_cvtsi32_si128(static_cast<int>(crc)),
+                                        _mm_cvtsi64_si128(static_cast<long long>(k)), 0x00);
+    return static_cast<uint32_t>(_mm_crc32_u64(0, static_cast<uint64_t>(_mm_cvtsi128_si64(prod))));
+}
+
+// Hides the 3-cycle crc32 latency by running three independent lanes and
+// folding the two leading lanes forward with a carry-less multiply.
+__attribute__((target("sse4.2,pclmul")))
+uint32_t crc32c_pclmul(uint32_t crc, const unsigned char* p, size_t len) {
+    while (len >= 3 * CRC_LANE_BYTES) {
+        uint64_t c0 = crc, c1 = 0, c2 = 0;
+        for (size_t i = 0; i < CRC_LANE_BYTES; i += 8) {
+            c0 = _mm_crc32_u64(c0, load_le64(p + i));
+            c1 = _mm_crc32_u64(c1, load_le64(p + CRC_LANE_BYTES + i));
+            c2 = _mm_crc32_u64(c2, load_le64(p + 2 * CRC_LANE_BYTES + i));
         }
+        crc = crc32c_shift(static_cast<uint32_t>(c0), crc_lane_shift2) ^
+              crc32c_shift(static_cast<uint32_t>(c1), crc_lane_shift1) ^
+              static_cast<uint32_t>(c2);
+        p += 3 * CRC_LANE_BYTES;
+        len -= 3 * CRC_LANE_BYTES;
+    }
+    return crc32c_sse42(crc, p, len);
+}
+#endif
+
+ChecksumEngine checksum_engine = {CHECKSUM_CRC32C_SW, "crc32c-slice8", crc32c_sw};
+
+vector<ChecksumEngine> available_checksum_engines() {
+    vector<ChecksumEngine> engines = {{CHECKSUM_CRC32C_SW, "crc32c-slice8", crc32c_sw}};
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("sse4.2")) {
+        engines.push_back({CHECKSUM_CRC32C_SSE42, "crc32c-sse4.2", crc32c_sse42});
+        if (__builtin_cpu_supports("pclmul")) {
+            engines.push_back({CHECKSUM_CRC32C_PCLMUL, "crc32c-pclmul", crc32c_pclmul});
+        }
+    }
+#endif
+    return engines;
+}
 
-        seq_num = stoi(packet.substr(0, first_colon));
-        data = packet.substr(first_colon + 1, last_colon - first_colon - 1);
-        int received_checksum = stoi(packet.substr(last_colon + 1));
-        
-        int calculated_checksum = 0;
-        for(char c : data) {
-            calculated_checksum += c;
+// Builds the software tables and picks the fastest engine via CPUID
+void init_checksum() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+        }
+        crc32c_table[0][i] = c;
+    }
+    for (int t = 1; t < 8; t++) {
+        for (int i = 0; i < 256; i++) {
+            uint32_t prev = crc32c_table[t - 1][i];
+            crc32c_table[t][i] = (prev >> 8) ^ crc32c_table[0][prev & 0xff];
         }
-        
-        return received_checksum == calculated_checksum;
-    } catch (...) {
+    }
+    crc_lane_shift1 = crc32c_xpow(8 * CRC_LANE_BYTES - 33);
+    crc_lane_shift2 = crc32c_xpow(16 * CRC_LANE_BYTES - 33);
+    checksum_engine = available_checksum_engines().back();
+}
+
+bool is_crc32c_type(uint8_t type) {
+    return type >= CHECKSUM_CRC32C_SW && type <= CHECKSUM_CRC32C_PCLMUL;
+}
+
+// Covers the payload followed by the header up to (not including) the
+// checksum field, so header-only changes can reuse the payload CRC.
+uint32_t packet_checksum(const PacketHeader& hdr, const char* payload, size_t len) {
+    uint32_t crc = checksum_engine.update(0xFFFFFFFFu, reinterpret_cast<const unsigned char*>(payload), len);
+    crc = checksum_engine.update(crc, reinterpret_cast<const unsigned char*>(&hdr),
+                                 offsetof(PacketHeader, checksum));
+    return ~crc;
+}
+
+bool validate_packet(const char* buf, size_t len, PacketView& pkt) {
+    if (len < HEADER_SIZE) return false;
+    PacketHeader hdr;
+    memcpy(&hdr, buf, HEADER_SIZE);
+    if (ntohs(hdr.magic) != PACKET_MAGIC || hdr.version != PROTOCOL_VERSION ||
+        !(hdr.flags & (FLAG_DATA | FLAG_REPAIR)) || !is_crc32c_type(hdr.checksum_type)) {
         return false;
     }
+
+    size_t payload_len = ntohs(hdr.payload_len);
+    if (HEADER_SIZE + payload_len != len) return false;
+    pkt.repair = hdr.flags & FLAG_REPAIR;
+    if (pkt.repair && payload_len < sizeof(FecHeader) + FEC_SYMBOL_PREFIX) return false;
+
+    pkt.conn_id = ntohl(hdr.conn_id);
+    pkt.seq_num = ntohl(hdr.seq_num);
+    pkt.payload = buf + HEADER_SIZE;
+    pkt.payload_len = payload_len;
+    pkt.fin = hdr.flags & FLAG_FIN;
+    pkt.syn = hdr.flags & FLAG_SYN;
+    pkt.fec = hdr.flags & FLAG_FEC;
+    pkt.attempt = hdr.attempt;
+    return ntohl(hdr.checksum) == packet_checksum(hdr, pkt.payload, payload_len);
+}
+
+// Forward error correction (--fec on the sender, Selective Repeat only). The
+// data packets of a stripe are grouped into blocks, and each block is
+// followed by repair packets, every one a different linear combination of
+// the block's coding symbols over GF(2^8). Repair j of a block with symbols
+// d_i is the sum of fec_matrix[j][i] * d_i. The matrix is a Cauchy matrix
+// with every column scaled so that row 0 is all ones: repair 0 is plain XOR
+// parity, yet any m rows still solve for any m missing symbols (a
+// systematic Reed-Solomon code), so a block survives as many losses as it
+// has repair packets.
+const unsigned GF_POLY = 0x11D;  // x^8 + x^4 + x^3 + x^2 + 1
+
+uint8_t gf_exp[512];  // Doubled so a sum of two logs needs no reduction
+uint8_t gf_log[256];
+uint8_t gf_nibble[256][2][16];  // c times each low nibble and each high nibble, for PSHUFB
+uint8_t fec_matrix[FEC_MAX_REPAIR][FEC_MAX_DATA];
+
+inline uint8_t gf_mul(uint8_t a, uint8_t b) {
+    return a && b ? gf_exp[gf_log[a] + gf_log[b]] : 0;
+}
+
+inline uint8_t gf_inv(uint8_t a) {
+    return gf_exp[255 - gf_log[a]];
+}
+
+// dst ^= c * src, bytewise
+typedef void (*GfMulAddFn)(uint8_t* dst, const uint8_t* src, size_t len, uint8_t c);
+
+void gf_mul_add_sw(uint8_t* dst, const uint8_t* src, size_t len, uint8_t c) {
+    const uint8_t* lo = gf_nibble[c][0];
+    const uint8_t* hi = gf_nibble[c][1];
+    for (size_t i = 0; i < len; i++) {
+        dst[i] ^= lo[src[i] & 0x0F] ^ hi[src[i] >> 4];
+    }
+}
+
+#if defined(__x86_64__)
+// Sixteen products per instruction: PSHUFB looks up both nibbles of every
+// byte in c's 16-entry tables
+__attribute__((target("ssse3")))
+void gf_mul_add_ssse3(uint8_t* dst, const uint8_t* src, size_t len, uint8_t c) {
+    const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(gf_nibble[c][0]));
+    const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(gf_nibble[c][1]));
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i p = _mm_xor_si128(_mm_shuffle_epi8(lo, _mm_and_si128(s, mask)),
+                                  _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi64(s, 4), mask)));
+        __m128i* d = reinterpret_cast<__m128i*>(dst + i);
+        _mm_storeu_si128(d, _mm_xor_si128(_mm_loadu_si128(d), p));
+    }
+    gf_mul_add_sw(dst + i, src + i, len - i, c);
+}
+
+// The same on 32 bytes, the tables repeated in both lanes
+__attribute__((target("avx2")))
+void gf_mul_add_avx2(uint8_t* dst, const uint8_t* src, size_t len, uint8_t c) {
+    const __m256i lo = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(gf_nibble[c][0])));
+    const __m256i hi = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(gf_nibble[c][1])));
+    const __m256i mask = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i p = _mm256_xor_si256(_mm256_shuffle_epi8(lo, _mm256_and_si256(s, mask)),
+                                     _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi64(s, 4), mask)));
+        __m256i* d = reinterpret_cast<__m256i*>(dst + i);
+        _mm256_storeu_si256(d, _mm256_xor_si256(_mm256_loadu_si256(d), p));
+    }
+    gf_mul_add_ssse3(dst + i, src + i, len - i, c);
+}
+#endif
+
+struct GfEngine {
+    const char* name;
+    GfMulAddFn mul_add;
+};
+
+GfEngine gf_engine = {"gf-table", gf_mul_add_sw};
+
+inline void gf_mul_add(uint8_t* dst, const uint8_t* src, size_t len, uint8_t c) {
+    if (c == 0) return;
+    if (c == 1) {
+        for (size_t i = 0; i < len; i++) dst[i] ^= src[i];  // XOR parity, vectorized by the compiler
+        return;
+    }
+    gf_engine.mul_add(dst, src, len, c);
+}
+
+// Builds the field tables and the coding matrix and picks the widest
+// PSHUFB the CPU has
+void init_fec() {
+    unsigned x = 1;
+    for (int i = 0; i < 255; i++) {
+        gf_exp[i] = gf_exp[i + 255] = static_cast<uint8_t>(x);
+        gf_log[x] = static_cast<uint8_t>(i);
+        x <<= 1;
+        if (x & 0x100) x ^= GF_POLY;
+    }
+    for (int c = 0; c < 256; c++) {
+        for (int n = 0; n < 16; n++) {
+            gf_nibble[c][0][n] = gf_mul(c, n);
+            gf_nibble[c][1][n] = gf_mul(c, n << 4);
+        }
+    }
+    // Cauchy entry 1 / (x_j + y_i) with x_j = FEC_MAX_DATA + j and y_i = i,
+    // column i divided by its row 0 entry
+    for (int j = 0; j < FEC_MAX_REPAIR; j++) {
+        for (int i = 0; i < FEC_MAX_DATA; i++) {
+            fec_matrix[j][i] = gf_mul(gf_inv((FEC_MAX_DATA + j) ^ i), FEC_MAX_DATA ^ i);
+        }
+    }
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2")) {
+        gf_engine = {"gf-avx2", gf_mul_add_avx2};
+    } else if (__builtin_cpu_supports("ssse3")) {
+        gf_engine = {"gf-ssse3", gf_mul_add_ssse3};
+    }
+#endif
 }
 
 // Add network interface detection
@@ -85,7 +561,9 @@ void print_available_interfaces() {
     cout << "\nAbove are your available network interfaces.\n";
 }
 
-int create_receiver_socket() {
+// With reuse_port the socket joins the port's SO_REUSEPORT group, and the
+// kernel spreads incoming datagrams over the group's sockets
+int create_receiver_socket(bool reuse_port = false) {
     int sock = socket(AF_INET, SOCK_DGRAM, 0);
     if (sock < 0) {
         handle_error("Socket creation failed");
@@ -101,6 +579,9 @@ int create_receiver_socket() {
     if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0) {
         handle_error("setsockopt(SO_REUSEADDR) failed");
     }
+    if (reuse_port && setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) < 0) {
+        handle_error("setsockopt(SO_REUSEPORT) failed");
+    }
     
     struct timeval tv;
     tv.tv_sec = TIMEOUT_SECONDS;
@@ -109,10 +590,31 @@ int create_receiver_socket() {
         handle_error("setsockopt(SO_RCVTIMEO) failed");
     }
     
-    int recv_buff_size = RECV_BUFFER_SIZE;
-    if (setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &recv_buff_size, sizeof(recv_buff_size)) < 0) {
+    if (options.gro) {
+        int on = 1;
+        if (setsockopt(sock, SOL_UDP, UDP_GRO, &on, sizeof(on)) < 0) {
+            cerr << "[Receiver] UDP_GRO not supported, receiving datagrams individually\n";
+            options.gro = false;
+        }
+    }
+
+    // Room for a whole reassembly window of full datagrams, or the window
+    // ACKs advertise shrinks to what the buffer holds. The kernel doubles
+    // what it is asked for and charges each datagram RCVBUF_DATAGRAM_COST;
+    // SO_RCVBUFFORCE gets past net.core.rmem_max where we are allowed to.
+    int needed = options.window * RCVBUF_DATAGRAM_COST;
+    int recv_buff_size = max(needed / 2, options.gro ? GRO_RECV_BUFFER_SIZE : RECV_BUFFER_SIZE);
+    if (setsockopt(sock, SOL_SOCKET, SO_RCVBUFFORCE, &recv_buff_size, sizeof(recv_buff_size)) < 0 &&
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &recv_buff_size, sizeof(recv_buff_size)) < 0) {
         handle_error("setsockopt(SO_RCVBUF) failed");
     }
+    int granted = 0;
+    socklen_t granted_len = sizeof(granted);
+    if (getsockopt(sock, SOL_SOCKET, SO_RCVBUF, &granted, &granted_len) == 0 && granted < needed) {
+        cerr << "[Receiver] Receive buffer capped at " << granted << " bytes (net.core.rmem_max), "
+             << "room for " << granted / RCVBUF_DATAGRAM_COST << " of the " << options.window
+             << "-packet window\n";
+    }
     
     sockaddr_in server_addr{};
     server_addr.sin_family = AF_INET;
@@ -127,245 +629,1972 @@ int create_receiver_socket() {
     return sock;
 }
 
-void send_ack(int sock, int seq_num, sockaddr_in& client_addr) {
-    string ack = to_string(seq_num);
-    socklen_t addr_len = sizeof(client_addr);
-    sendto(sock, ack.c_str(), ack.length(), 0, 
-           (sockaddr*)&client_addr, addr_len);
-    cout << "[Receiver] Sent ACK: " << seq_num << "\n";
+uint64_t now_us() {
+    return chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Waits until sock is readable or timeout_us has passed. False on timeout.
+bool wait_readable(int sock, uint64_t timeout_us) {
+    pollfd pfd{sock, POLLIN, 0};
+    timespec ts;
+    ts.tv_sec = timeout_us / 1000000;
+    ts.tv_nsec = (timeout_us % 1000000) * 1000;
+    return ppoll(&pfd, 1, &ts, nullptr) > 0;
+}
+
+// Full-size datagrams sock's receive buffer can still queue before the
+// kernel starts dropping them
+int receive_buffer_room(int sock) {
+    uint32_t meminfo[SK_MEMINFO_VARS];
+    socklen_t len = sizeof(meminfo);
+    if (getsockopt(sock, SOL_SOCKET, SO_MEMINFO, meminfo, &len) < 0) return MAX_RECV_WINDOW;
+    uint32_t used = meminfo[SK_MEMINFO_RMEM_ALLOC], size = meminfo[SK_MEMINFO_RCVBUF];
+    return used < size ? (size - used) / RCVBUF_DATAGRAM_COST : 0;
 }
 
-pair<int, string> extract_packet_data(const string& packet) {
-    size_t pos = packet.find(":");
-    if (pos == string::npos) {
-        throw runtime_error("Invalid packet format");
+// One received datagram. data points into a receive buffer owned by the transport.
+struct Datagram {
+    const char* data;
+    size_t len;
+    const sockaddr_in* source;
+};
+
+// Segment size of a coalesced (UDP_GRO) read, or 0 if it holds a single datagram
+size_t gro_segment_size(msghdr& hdr) {
+    for (cmsghdr* cm = CMSG_FIRSTHDR(&hdr); cm; cm = CMSG_NXTHDR(&hdr, cm)) {
+        if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+            int size;
+            memcpy(&size, CMSG_DATA(cm), sizeof(size));
+            return size > 0 ? size : 0;
+        }
     }
-    int seq_num = stoi(packet.substr(0, pos));
-    string data = packet.substr(pos + 1);
-    return {seq_num, data};
+    return 0;
 }
 
-void process_received_data(const string& data) {
-    // No longer print messages
-    return;
+// Splits one read back into the datagrams the kernel coalesced into it
+void split_read(vector<Datagram>& out, const char* data, size_t len, size_t segment,
+                const sockaddr_in* source) {
+    if (segment == 0) segment = max<size_t>(len, 1);
+    for (size_t off = 0; off < len; off += segment) {
+        out.push_back({data + off, min(segment, len - off), source});
+    }
 }
 
-class PacketQueue {
-    deque<pair<int, string>> packets;
-    mutex mtx;
-    condition_variable cv;
-    size_t max_size;
+const size_t GRO_CONTROL_SPACE = CMSG_SPACE(sizeof(int));
+
+// Preallocated receive buffers filled by one recvmmsg() call. The call blocks
+// for the first datagram (up to SO_RCVTIMEO) and then takes whatever else is
+// already queued, so a busy socket is drained up to capacity per syscall.
+//
+// With UDP_GRO on, one buffer may hold several datagrams coalesced by the
+// kernel; the gso_size cmsg gives their size and receive() splits them up
+// again, so callers always see individual datagrams.
+class RxBatch {
+    size_t buffer_size;
+    vector<char> storage;
+    vector<mmsghdr> msgs;
+    vector<iovec> iovs;
+    vector<sockaddr_in> addrs;
+    vector<char> controls;
+    vector<Datagram> datagrams;
 public:
-    explicit PacketQueue(size_t size = MAX_QUEUE_SIZE) : max_size(size) {}
-    
-    void push(int seq_num, string data) {
-        unique_lock<mutex> lock(mtx);
-        cv.wait(lock, [this]{ return packets.size() < max_size; });
-        packets.emplace_back(seq_num, move(data));
-        cv.notify_one();
+    RxBatch(size_t capacity, size_t buffer)
+        : buffer_size(buffer), storage(max<size_t>(capacity, 1) * buffer),
+          msgs(max<size_t>(capacity, 1)), iovs(msgs.size()), addrs(msgs.size()),
+          controls(msgs.size() * GRO_CONTROL_SPACE) {
+        for (size_t i = 0; i < msgs.size(); i++) {
+            iovs[i].iov_base = &storage[i * buffer_size];
+            iovs[i].iov_len = buffer_size;
+        }
+        datagrams.reserve(msgs.size());
     }
-    
-    pair<int, string> pop() {
-        unique_lock<mutex> lock(mtx);
-        cv.wait(lock, [this]{ return !packets.empty() || !::running; });
-        if (!::running) throw runtime_error("Shutdown requested");
-        auto packet = move(packets.front());
-        packets.pop_front();
-        cv.notify_one();
-        return packet;
+
+    // Number of datagrams received, or -1 with errno set
+    int receive(int sock, ReceiverStats& stats) {
+        for (size_t i = 0; i < msgs.size(); i++) {
+            msghdr& hdr = msgs[i].msg_hdr;
+            memset(&hdr, 0, sizeof(hdr));
+            hdr.msg_name = &addrs[i];
+            hdr.msg_namelen = sizeof(sockaddr_in);
+            hdr.msg_iov = &iovs[i];
+            hdr.msg_iovlen = 1;
+            hdr.msg_control = &controls[i * GRO_CONTROL_SPACE];
+            hdr.msg_controllen = GRO_CONTROL_SPACE;
+        }
+        int count = recvmmsg(sock, msgs.data(), msgs.size(), MSG_WAITFORONE, nullptr);
+        if (count < 0) return -1;
+
+        datagrams.clear();
+        for (int m = 0; m < count; m++) {
+            split_read(datagrams, static_cast<const char*>(iovs[m].iov_base), msgs[m].msg_len,
+                       gro_segment_size(msgs[m].msg_hdr), &addrs[m]);
+        }
+        stats.recv_syscalls++;
+        stats.datagrams_received += datagrams.size();
+        return datagrams.size();
     }
+
+    const Datagram& operator[](int i) const { return datagrams[i]; }
 };
 
-void packet_processor(PacketQueue& queue, ReceiverStats& stats) {
-    while(running) {
-        try {
-            auto [seq_num, data] = queue.pop();
-            process_received_data(data);
-            stats.total_bytes_received += data.length();
-        } catch(const exception& e) {
-            if(running) cerr << "Processor error: " << e.what() << endl;
+// Where the receive loops get their datagrams from and send their ACKs
+// through, chosen with --backend.
+class Transport {
+public:
+    virtual ~Transport() {}
+
+    // Blocks up to TIMEOUT_SECONDS for the first datagram, then takes what
+    // else is ready. Count, or -1 with errno set (EAGAIN on timeout). The
+    // datagrams stay valid until the next receive() or wait_readable().
+    virtual int receive(ReceiverStats& stats) = 0;
+    virtual const Datagram& datagram(int i) const = 0;
+    // False if nothing arrived within timeout_us
+    virtual bool wait_readable(uint64_t timeout_us) = 0;
+    virtual void send(const void* buf, size_t len, const sockaddr_in& dest) = 0;
+    // Datagrams that could still be queued for receive() without loss, as
+    // of the last receive()
+    virtual int receive_room() const = 0;
+};
+
+// Plain socket calls: recvmmsg() batches and sendto() for ACKs
+class SocketTransport : public Transport {
+    int sock;
+    RxBatch batch;
+    int room = MAX_RECV_WINDOW;
+public:
+    explicit SocketTransport(int socket_fd)
+        : sock(socket_fd),
+          batch(options.batch_size, options.gro ? GRO_BUFFER_SIZE : REPAIR_PACKET_SIZE) {}
+    ~SocketTransport() { close(sock); }
+
+    int receive(ReceiverStats& stats) override {
+        int count = batch.receive(sock, stats);
+        room = receive_buffer_room(sock);
+        return count;
+    }
+    const Datagram& datagram(int i) const override { return batch[i]; }
+    int receive_room() const override { return room; }
+    bool wait_readable(uint64_t timeout_us) override { return ::wait_readable(sock, timeout_us); }
+
+    void send(const void* buf, size_t len, const sockaddr_in& dest) override {
+        sendto(sock, buf, len, 0, (const sockaddr*)&dest, sizeof(dest));
+    }
+};
+
+// Minimal io_uring over the raw syscalls: the submission and completion
+// rings mapped into the process and one registered file (index 0).
+class IoUring {
+    int ring_fd;
+    bool sqpoll;
+    void* sq_map = MAP_FAILED;
+    void* cq_map = MAP_FAILED;
+    size_t sq_map_len = 0, cq_map_len = 0, sqes_len = 0;
+    io_uring_sqe* sqes = nullptr;
+    unsigned *sq_head, *sq_tail, *sq_flags;
+    unsigned sq_mask, sq_entries;
+    unsigned *cq_head, *cq_tail;
+    unsigned cq_mask;
+    io_uring_cqe* cqes;
+    unsigned sqe_tail = 0;       // Next free SQE; published to the kernel by submit()
+public:
+    uint64_t enters = 0;         // io_uring_enter() calls made so far
+
+    IoUring(unsigned entries, bool use_sqpoll) : sqpoll(use_sqpoll) {
+        io_uring_params params{};
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * URING_CQ_FACTOR;
+        if (sqpoll) {
+            params.flags |= IORING_SETUP_SQPOLL;
+            params.sq_thread_idle = URING_SQPOLL_IDLE_MS;
         }
+        ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+        if (ring_fd < 0) handle_error("io_uring_setup failed");
+
+        sq_map_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_map_len = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) sq_map_len = cq_map_len = max(sq_map_len, cq_map_len);
+        sq_map = mmap(nullptr, sq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd, IORING_OFF_SQ_RING);
+        cq_map = single_mmap ? sq_map
+                             : mmap(nullptr, cq_map_len, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        sqes_len = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqe_map = mmap(nullptr, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring_fd, IORING_OFF_SQES);
+        if (sq_map == MAP_FAILED || cq_map == MAP_FAILED || sqe_map == MAP_FAILED) {
+            handle_error("io_uring mmap failed");
+        }
+        sqes = static_cast<io_uring_sqe*>(sqe_map);
+
+        char* sq = static_cast<char*>(sq_map);
+        sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_flags = reinterpret_cast<unsigned*>(sq + params.sq_off.flags);
+        sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_entries = params.sq_entries;
+        unsigned* sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        for (unsigned i = 0; i < sq_entries; i++) sq_array[i] = i;
+
+        char* cq = static_cast<char*>(cq_map);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        sqe_tail = *sq_tail;
     }
-}
 
-void stop_and_wait_receiver() {
-    int sock = create_receiver_socket();
-    
-    ReceiverStats stats;
-    int expected_seq_num = 0;
-    int timeout_count = 0;
-    const int MAX_TIMEOUTS = 5;
-    cout << "[Receiver] Started in Stop-and-Wait mode. Waiting for packets...\n";
+    ~IoUring() {
+        munmap(sqes, sqes_len);
+        if (cq_map != sq_map) munmap(cq_map, cq_map_len);
+        munmap(sq_map, sq_map_len);
+        close(ring_fd);
+    }
 
-    PacketQueue packet_queue;
-    thread processor(packet_processor, ref(packet_queue), ref(stats));
-    
-    while (timeout_count < MAX_TIMEOUTS && running) {
-        char buffer[MAX_BUFFER_SIZE] = {0};
-        sockaddr_in client_addr{};
-        socklen_t addr_len = sizeof(client_addr);
-        
-        int bytes_received = recvfrom(sock, buffer, sizeof(buffer), 0, 
-                                    (sockaddr*)&client_addr, &addr_len);
-
-        if (bytes_received < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                timeout_count++;
-                cout << "[Receiver] Timeout " << timeout_count << "/" << MAX_TIMEOUTS << endl;
-                continue;
-            }
-            handle_error("recvfrom failed");
+    int fd() const { return ring_fd; }
+
+    void register_file(int file) {
+        if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_FILES, &file, 1) < 0) {
+            handle_error("IORING_REGISTER_FILES failed");
         }
+    }
 
-        timeout_count = 0;
+    // A zeroed SQE to fill in; submits queued ones first if the ring is full
+    io_uring_sqe* get_sqe() {
+        while (sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+            submit();
+        }
+        io_uring_sqe* sqe = &sqes[sqe_tail & sq_mask];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe_tail++;
+        return sqe;
+    }
 
-        string packet(buffer, bytes_received);
-        int seq_num;
-        string data;
-        if (validate_packet(packet, seq_num, data)) {
-            cout << "[Receiver] Received packet " << seq_num << "\n";
-            stats.packets_received++;
-            packet_queue.push(seq_num, data);
-
-            if (seq_num == expected_seq_num) {
-                send_ack(sock, seq_num, client_addr);
-                expected_seq_num++;
-            } else {
-                stats.out_of_order++;
-                cout << "[Receiver] Out of order packet. Expected " 
-                     << expected_seq_num << ", got " << seq_num << "\n";
-                send_ack(sock, expected_seq_num - 1, client_addr);
+    // Hands queued SQEs to the kernel and, with wait_nr > 0, waits for that
+    // many completions or timeout_us. Skips the syscall when there is nothing
+    // to do (SQPOLL picks up new entries by itself). False on timeout.
+    bool submit(unsigned wait_nr = 0, uint64_t timeout_us = UINT64_MAX) {
+        unsigned to_submit = sqe_tail - *sq_tail;
+        __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+        unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+        if (sqpoll) {
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            if (__atomic_load_n(sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) {
+                flags |= IORING_ENTER_SQ_WAKEUP;
+            }
+            if (flags == 0) return true;
+        } else if (to_submit == 0 && wait_nr == 0) {
+            return true;
+        }
+
+        __kernel_timespec ts{};
+        io_uring_getevents_arg arg{};
+        const void* argp = nullptr;
+        size_t argsz = 0;
+        if (wait_nr && timeout_us != UINT64_MAX) {
+            ts.tv_sec = timeout_us / 1000000;
+            ts.tv_nsec = (timeout_us % 1000000) * 1000;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+            flags |= IORING_ENTER_EXT_ARG;
+            argp = &arg;
+            argsz = sizeof(arg);
+        }
+        enters++;
+        if (syscall(__NR_io_uring_enter, ring_fd, to_submit, wait_nr, flags, argp, argsz) < 0) {
+            if (errno == ETIME) return false;
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                handle_error("io_uring_enter failed");
             }
-        } else {
-            stats.corrupted_packets++;
-            cerr << "[Receiver] Invalid packet received\n";
         }
+        return true;
     }
 
-    running = false;
-    processor.join();
-    cout << "[Receiver] Terminating due to " << MAX_TIMEOUTS << " consecutive timeouts\n";
-    close(sock);
-    stats.print();
-}
+    bool cq_ready() const {
+        return *cq_head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    }
 
-void go_back_n_receiver() {
-    int sock = create_receiver_socket();
-    
-    ReceiverStats stats;
-    int expected_seq_num = 0;
-    vector<bool> received_packets(1000, false);
+    // Passes every ready completion to handler and consumes them
+    template <typename Handler>
+    void reap(Handler handler) {
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            handler(cqes[head & cq_mask]);
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+};
 
-    cout << "[Receiver] Started in Go-Back-N mode. Waiting for packets...\n";
+// Receive buffers registered with the kernel as a provided-buffer ring
+// (IORING_REGISTER_PBUF_RING). A multishot recvmsg picks the next free one
+// for each datagram, and the buffer goes back on the ring once consumed.
+class ProvidedBuffers {
+    io_uring_buf* ring;
+    size_t ring_len;
+    unsigned entries;
+    size_t buf_size;
+    vector<char> storage;
+    uint16_t tail = 0;
 
-    while (true) {
-        char buffer[MAX_BUFFER_SIZE] = {0};
-        sockaddr_in client_addr{};
-        socklen_t addr_len = sizeof(client_addr);
-        
-        int bytes_received = recvfrom(sock, buffer, sizeof(buffer), 0, 
-                                    (sockaddr*)&client_addr, &addr_len);
-
-        if (bytes_received > 0) {
-            string packet(buffer, bytes_received);
-            int seq_num;
-            string data;
-            if (validate_packet(packet, seq_num, data)) {
-                cout << "[Receiver] Received packet " << seq_num << "\n";
-                stats.packets_received++;
-                stats.total_bytes_received += data.length();
-                process_received_data(data);
-
-                if (seq_num == expected_seq_num) {
-                    send_ack(sock, seq_num, client_addr);
-                    received_packets[seq_num] = true;
-                    
-                    while (received_packets[expected_seq_num]) {
-                        expected_seq_num++;
-                    }
-                } else {
-                    stats.out_of_order++;
-                    cout << "[Receiver] Out of order packet. Expected " 
-                         << expected_seq_num << ", got " << seq_num << "\n";
-                    if (seq_num > expected_seq_num) {
-                        send_ack(sock, expected_seq_num - 1, client_addr);
-                    }
-                }
-            } else {
-                stats.corrupted_packets++;
-                cerr << "[Receiver] Invalid packet received\n";
-            }
+    void add(unsigned bid) {
+        io_uring_buf& buf = ring[tail & (entries - 1)];
+        buf.addr = reinterpret_cast<uint64_t>(buffer(bid));
+        buf.len = buf_size;
+        buf.bid = bid;
+        tail++;
+    }
+
+    void publish() {
+        __atomic_store_n(&reinterpret_cast<io_uring_buf_ring*>(ring)->tail, tail, __ATOMIC_RELEASE);
+    }
+public:
+    const uint16_t group;
+
+    // count must be a power of two
+    ProvidedBuffers(IoUring& uring, uint16_t group_id, unsigned count, size_t size)
+        : ring_len(count * sizeof(io_uring_buf)), entries(count), buf_size(size),
+          storage(count * size), group(group_id) {
+        void* mem = mmap(nullptr, ring_len, PROT_READ | PROT_WRITE,
+                         MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+        if (mem == MAP_FAILED) handle_error("buffer ring mmap failed");
+        ring = static_cast<io_uring_buf*>(mem);
+
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+        reg.ring_entries = entries;
+        reg.bgid = group;
+        if (syscall(__NR_io_uring_register, uring.fd(), IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+            handle_error("IORING_REGISTER_PBUF_RING failed");
         }
+        for (unsigned bid = 0; bid < entries; bid++) add(bid);
+        publish();
+    }
+
+    ~ProvidedBuffers() { munmap(ring, ring_len); }
+
+    char* buffer(unsigned bid) { return &storage[bid * buf_size]; }
+
+    void recycle(unsigned bid) {
+        add(bid);
+        publish();
     }
+};
 
-    close(sock);
-    stats.print();
+// Smallest power of two >= n
+unsigned round_up_pow2(unsigned n) {
+    unsigned p = 1;
+    while (p < n) p <<= 1;
+    return p;
 }
 
-void selective_repeat_receiver() {
-    int sock = create_receiver_socket();
-    
-    ReceiverStats stats;
-    int expected_seq_num = 0;
-    vector<bool> received_packets(1000, false);
-    vector<string> packet_buffer(1000);
+// io_uring transport: one multishot recvmsg keeps the socket armed and
+// fills provided buffers without a syscall per datagram, and ACKs go out as
+// sendmsg SQEs that are submitted together with the next wait. With
+// --sqpoll a kernel thread submits them, so a loaded receiver barely enters
+// the kernel at all.
+class UringTransport : public Transport {
+    static const uint64_t RECV_TAG = UINT64_MAX;  // ACK sends use their slot index
+    static const unsigned ACK_SLOTS = 64;
 
-    cout << "[Receiver] Started in Selective Repeat mode. Waiting for packets...\n";
+    // An ACK frame and its msghdr, kept alive until the send completes
+    struct AckSlot {
+        char frame[sizeof(AckFrame)];
+        sockaddr_in dest;
+        iovec iov;
+        msghdr msg;
+        bool busy = false;
+    };
 
-    while (true) {
-        char buffer[MAX_BUFFER_SIZE] = {0};
-        sockaddr_in client_addr{};
-        socklen_t addr_len = sizeof(client_addr);
-        
-        int bytes_received = recvfrom(sock, buffer, sizeof(buffer), 0, 
-                                    (sockaddr*)&client_addr, &addr_len);
-
-        if (bytes_received > 0) {
-            string packet(buffer, bytes_received);
-            int seq_num;
-            string data;
-            if (validate_packet(packet, seq_num, data)) {
-                cout << "[Receiver] Received packet " << seq_num << "\n";
-                stats.packets_received++;
-                stats.total_bytes_received += data.length();
-                process_received_data(data);
-
-                if (seq_num >= expected_seq_num) {
-                    received_packets[seq_num] = true;
-                    packet_buffer[seq_num] = string(buffer, bytes_received);
-                    send_ack(sock, seq_num, client_addr);
-                    
-                    while (received_packets[expected_seq_num]) {
-                        cout << "[Receiver] Delivering packet " << expected_seq_num << "\n";
-                        expected_seq_num++;
-                    }
-                } else {
-                    stats.out_of_order++;
-                    cout << "[Receiver] Out of order packet " << seq_num << "\n";
-                    send_ack(sock, seq_num, client_addr);
-                }
-            } else {
-                stats.corrupted_packets++;
-                cerr << "[Receiver] Invalid packet received\n";
+    int sock;
+    IoUring ring;
+    size_t capacity;
+    size_t payload_size;
+    msghdr recv_template{};      // Name and control space reserved in each buffer
+    ProvidedBuffers buffers;
+    bool recv_armed = false;
+    deque<io_uring_cqe> ready;   // Receive completions not handed out yet
+    vector<unsigned> held;       // Buffers behind the current batch
+    vector<Datagram> datagrams;
+    vector<AckSlot> slots;
+    unsigned next_slot = 0;
+    uint64_t counted_enters = 0;
+    int room = MAX_RECV_WINDOW;
+
+    static size_t buffer_size(size_t payload) {
+        return sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in) + GRO_CONTROL_SPACE + payload;
+    }
+
+    void arm_recv() {
+        io_uring_sqe* sqe = ring.get_sqe();
+        sqe->opcode = IORING_OP_RECVMSG;
+        sqe->fd = 0;
+        sqe->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->addr = reinterpret_cast<uint64_t>(&recv_template);
+        sqe->len = 1;
+        sqe->buf_group = buffers.group;
+        sqe->user_data = RECV_TAG;
+        recv_armed = true;
+    }
+
+    void on_completion(const io_uring_cqe& cqe) {
+        if (cqe.user_data == RECV_TAG) {
+            // The multishot request ends on errors, including running out of buffers
+            if (!(cqe.flags & IORING_CQE_F_MORE)) recv_armed = false;
+            if (cqe.flags & IORING_CQE_F_BUFFER) {
+                ready.push_back(cqe);
+            } else if (cqe.res < 0 && cqe.res != -ENOBUFS) {
+                cerr << "[Receiver] recvmsg failed: " << strerror(-cqe.res) << "\n";
             }
+            return;
         }
+        slots[cqe.user_data].busy = false;
+        if (cqe.res < 0) cerr << "[Receiver] ACK send failed: " << strerror(-cqe.res) << "\n";
     }
 
-    close(sock);
-    stats.print();
-}
+    void reap() {
+        ring.reap([this](const io_uring_cqe& cqe) { on_completion(cqe); });
+    }
 
-void receiver(Protocol protocol) {
-    if (protocol == STOP_AND_WAIT) {
-        stop_and_wait_receiver();
-    } else if (protocol == GO_BACK_N) {
-        go_back_n_receiver();
-    } else {
-        selective_repeat_receiver();
+    // Returns the previous batch's buffers to the kernel
+    void release_batch() {
+        for (unsigned bid : held) buffers.recycle(bid);
+        held.clear();
+        datagrams.clear();
+    }
+
+    // Waits until at least one receive completion is ready. False on timeout.
+    bool wait_for_data(uint64_t timeout_us) {
+        uint64_t deadline = timeout_us == UINT64_MAX ? UINT64_MAX : now_us() + timeout_us;
+        while (true) {
+            reap();
+            if (!recv_armed) arm_recv();
+            if (!ready.empty()) {
+                ring.submit();  // Pending ACKs
+                return true;
+            }
+            uint64_t now = now_us();
+            if (now >= deadline || !ring.submit(1, deadline == UINT64_MAX ? UINT64_MAX : deadline - now)) {
+                reap();
+                return !ready.empty();
+            }
+        }
+    }
+public:
+    explicit UringTransport(int socket_fd)
+        : sock(socket_fd), ring(URING_ENTRIES, options.sqpoll),
+          capacity(max(options.batch_size, 1)),
+          payload_size(options.gro ? GRO_BUFFER_SIZE : REPAIR_PACKET_SIZE),
+          buffers(ring, 0, round_up_pow2(max<size_t>(4 * capacity, URING_MIN_BUFFERS)),
+                  buffer_size(payload_size)),
+          slots(ACK_SLOTS) {
+        ring.register_file(sock);
+        recv_template.msg_namelen = sizeof(sockaddr_in);
+        recv_template.msg_controllen = GRO_CONTROL_SPACE;
+        arm_recv();
+        ring.submit();
+    }
+    ~UringTransport() { close(sock); }
+
+    int receive(ReceiverStats& stats) override {
+        release_batch();
+        bool got = wait_for_data(TIMEOUT_SECONDS * 1000000ULL);
+        stats.recv_syscalls += ring.enters - counted_enters;
+        counted_enters = ring.enters;
+        if (!got) {
+            errno = EAGAIN;
+            return -1;
+        }
+
+        for (size_t taken = 0; taken < capacity && !ready.empty(); taken++) {
+            io_uring_cqe cqe = ready.front();
+            ready.pop_front();
+            unsigned bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+            held.push_back(bid);
+
+            // Buffer layout: recvmsg_out, name, control, payload
+            char* buf = buffers.buffer(bid);
+            const io_uring_recvmsg_out* out = reinterpret_cast<const io_uring_recvmsg_out*>(buf);
+            size_t header = sizeof(*out) + recv_template.msg_namelen + recv_template.msg_controllen;
+            if (cqe.res < static_cast<int>(header)) continue;
+            msghdr control{};
+            control.msg_control = buf + sizeof(*out) + recv_template.msg_namelen;
+            control.msg_controllen = out->controllen;
+            size_t len = min<size_t>(out->payloadlen, cqe.res - header);
+            split_read(datagrams, buf + header, len, gro_segment_size(control),
+                       reinterpret_cast<const sockaddr_in*>(buf + sizeof(*out)));
+        }
+        stats.datagrams_received += datagrams.size();
+        room = receive_buffer_room(sock);
+        return datagrams.size();
+    }
+
+    const Datagram& datagram(int i) const override { return datagrams[i]; }
+    int receive_room() const override { return room; }
+
+    bool wait_readable(uint64_t timeout_us) override {
+        release_batch();
+        return wait_for_data(timeout_us);
     }
+
+    void send(const void* buf, size_t len, const sockaddr_in& dest) override {
+        AckSlot& slot = slots[next_slot];
+        while (slot.busy) {
+            ring.submit(1);
+            reap();
+        }
+        slot.busy = true;
+        len = min(len, sizeof(slot.frame));
+        memcpy(slot.frame, buf, len);
+        slot.dest = dest;
+        slot.iov = {slot.frame, len};
+        slot.msg = {};
+        slot.msg.msg_name = &slot.dest;
+        slot.msg.msg_namelen = sizeof(slot.dest);
+        slot.msg.msg_iov = &slot.iov;
+        slot.msg.msg_iovlen = 1;
+
+        io_uring_sqe* sqe = ring.get_sqe();
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = 0;
+        sqe->flags = IOSQE_FIXED_FILE;
+        sqe->addr = reinterpret_cast<uint64_t>(&slot.msg);
+        sqe->len = 1;
+        sqe->user_data = next_slot;
+        next_slot = (next_slot + 1) % ACK_SLOTS;
+    }
+};
+
+// Takes ownership of sock
+unique_ptr<Transport> make_transport(int sock) {
+    if (options.backend == BACKEND_IO_URING) {
+        return unique_ptr<Transport>(new UringTransport(sock));
+    }
+    return unique_ptr<Transport>(new SocketTransport(sock));
 }
 
-int main() {
+inline uint64_t reverse_bits(uint64_t v) {
+    v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+    v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+    v = ((v >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return __builtin_bswap64(v);
+}
+
+// Selective Repeat reassembly window: which of the sequence numbers
+// [base, base + capacity) have arrived, one bit per slot of a power-of-two
+// ring indexed by seq modulo capacity. Payloads go straight to their output
+// offset on arrival, so the bitmap is all the state there is and memory is
+// bounded by the advertised window however long the session runs.
+class ReassemblyWindow {
+    vector<uint64_t> bits;
+    uint32_t mask;
+    uint32_t base = 0;  // First sequence number not yet received
+    uint32_t held = 0;  // Received packets beyond it
+
+    bool test(uint32_t seq) const {
+        uint32_t slot = seq & mask;
+        return bits[slot >> 6] >> (slot & 63) & 1;
+    }
+
+    // The 64 slots starting at seq, seq's slot in the lowest bit
+    uint64_t word_at(uint32_t seq) const {
+        uint32_t slot = seq & mask;
+        uint32_t shift = slot & 63;
+        uint64_t w = bits[slot >> 6] >> shift;
+        if (shift) w |= bits[((slot >> 6) + 1) & (bits.size() - 1)] << (64 - shift);
+        return w;
+    }
+public:
+    explicit ReassemblyWindow(int capacity) : bits(capacity / 64), mask(capacity - 1) {}
+
+    // Empties the window and starts it at new_base
+    void reset(uint32_t new_base) {
+        fill(bits.begin(), bits.end(), 0);
+        base = new_base;
+        held = 0;
+    }
+
+    uint32_t next_expected() const { return base; }
+    uint32_t capacity() const { return mask + 1; }
+    uint32_t held_count() const { return held; }
+
+    bool in_window(uint32_t seq) const {
+        int32_t offset = seq_diff(seq, base);
+        return offset >= 0 && static_cast<uint32_t>(offset) <= mask;
+    }
+
+    // Whether seq has arrived: behind base, or marked in the window
+    bool has(uint32_t seq) const {
+        return seq_before(seq, base) || (in_window(seq) && test(seq));
+    }
+
+    // Marks an in-window seq as received; false if it already was
+    bool insert(uint32_t seq) {
+        if (test(seq)) return false;
+        uint32_t slot = seq & mask;
+        bits[slot >> 6] |= uint64_t(1) << (slot & 63);
+        held++;
+        return true;
+    }
+
+    // Slides base over the run of received packets starting at it, clearing
+    // their slots a word at a time. Returns how many were passed.
+    uint32_t advance() {
+        uint32_t start = base;
+        while (true) {
+            uint32_t slot = base & mask;
+            uint32_t shift = slot & 63;
+            uint64_t& word = bits[slot >> 6];
+            uint64_t run_bits = ~(word >> shift);
+            uint32_t run = run_bits ? __builtin_ctzll(run_bits) : 64;
+            run = min(run, 64 - shift);
+            if (run == 0) break;
+            uint64_t cleared = run == 64 ? ~uint64_t(0) : ((uint64_t(1) << run) - 1) << shift;
+            word &= ~cleared;
+            base += run;
+            if (shift + run < 64) break;  // Stopped at a missing packet
+        }
+        held -= base - start;
+        return base - start;
+    }
+
+    // Fills the SACK bitmap for packets held beyond base (bit 0 of word 0,
+    // most significant first, is base + 1) and returns the number of words
+    // worth sending
+    int build_sack(uint64_t* sack) const {
+        int words = 0;
+        for (int w = 0; w < MAX_SACK_WORDS; w++) {
+            uint32_t offset = 1 + w * 64;
+            uint64_t v = 0;
+            if (offset <= mask) {
+                v = word_at(base + offset);
+                uint32_t valid = mask + 1 - offset;  // Slots past the window alias old ones
+                if (valid < 64) v &= (uint64_t(1) << valid) - 1;
+            }
+            sack[w] = reverse_bits(v);
+            if (sack[w]) words = w + 1;
+        }
+        return words;
+    }
+};
+
+// Inverts the n x n matrix a over GF(2^8) by Gauss-Jordan elimination; a
+// is destroyed. False if it is singular, which a corrupted block can make it.
+bool gf_invert(uint8_t a[][FEC_MAX_REPAIR], uint8_t inv[][FEC_MAX_REPAIR], int n) {
+    for (int r = 0; r < n; r++) {
+        for (int c = 0; c < n; c++) inv[r][c] = r == c;
+    }
+    for (int col = 0; col < n; col++) {
+        int pivot = col;
+        while (pivot < n && a[pivot][col] == 0) pivot++;
+        if (pivot == n) return false;
+        swap(a[pivot], a[col]);
+        swap(inv[pivot], inv[col]);
+        uint8_t scale = gf_inv(a[col][col]);
+        for (int c = 0; c < n; c++) {
+            a[col][c] = gf_mul(a[col][c], scale);
+            inv[col][c] = gf_mul(inv[col][c], scale);
+        }
+        for (int r = 0; r < n; r++) {
+            uint8_t f = a[r][col];
+            if (r == col || f == 0) continue;
+            for (int c = 0; c < n; c++) {
+                a[r][c] ^= gf_mul(f, a[col][c]);
+                inv[r][c] ^= gf_mul(f, inv[col][c]);
+            }
+        }
+    }
+    return true;
+}
+
+// Rebuilds the lost data packets of a Selective Repeat session that sends
+// repair packets (see fec_matrix). Solving a block takes the symbols of the
+// packets that did arrive, while their payloads have long gone to the
+// output file, so each one is copied into a ring indexed like
+// ReassemblyWindow and tagged with its seq in case the slot is reused before
+// its block is settled. A block's repair packets are held until enough of
+// the block is in to solve for the rest; blocks are dropped once solved or
+// once the window has passed them. A block that is still short after its
+// last repair packet is left to retransmission.
+class FecDecoder {
+    struct Block {
+        int data_count;
+        int repair_count;
+        size_t coded_len;
+        uint32_t have = 0;        // Repair packets received, bit j for row j
+        vector<uint8_t> repairs;  // repair_count symbols of coded_len bytes
+
+        Block(int data, int repair, size_t len)
+            : data_count(data), repair_count(repair), coded_len(len), repairs(repair * len) {}
+    };
+
+    vector<uint8_t> symbols;  // FEC_SYMBOL_SIZE per slot
+    vector<uint32_t> held_seq;
+    vector<uint16_t> held_len;  // Symbol length without the zero padding, 0 for an empty slot
+    uint32_t mask;
+    unordered_map<uint32_t, Block> blocks;  // By first seq
+    vector<vector<uint8_t>> recovered;      // Symbols rebuilt in this batch, see release()
+
+    const uint8_t* held(uint32_t seq, size_t& len) const {
+        uint32_t slot = seq & mask;
+        if (held_len[slot] == 0 || held_seq[slot] != seq) return nullptr;
+        len = held_len[slot];
+        return &symbols[slot * FEC_SYMBOL_SIZE];
+    }
+
+    // Solves block first for its missing packets if it has enough repairs,
+    // appending them to out. False while it has to wait for more.
+    bool solve(uint32_t first, const Block& block, const PacketView& repair,
+               const ReassemblyWindow& window, vector<PacketView>& out) {
+        int rows[FEC_MAX_REPAIR], missing[FEC_MAX_REPAIR];
+        int available = __builtin_popcount(block.have), m = 0;
+        for (int i = 0; i < block.data_count; i++) {
+            uint32_t seq = first + i;
+            if (window.has(seq)) continue;
+            if (m == available || !window.in_window(seq)) return false;
+            missing[m++] = i;
+        }
+        if (m == 0) return true;
+        for (int j = 0, r = 0; r < m; j++) {
+            if (block.have >> j & 1) rows[r++] = j;
+        }
+
+        // Take the received packets' share out of the chosen repairs,
+        // leaving the missing packets' combinations
+        size_t len = block.coded_len;
+        vector<uint8_t> syndromes(m * len);
+        for (int r = 0; r < m; r++) {
+            memcpy(&syndromes[r * len], &block.repairs[rows[r] * len], len);
+        }
+        for (int i = 0, k = 0; i < block.data_count; i++) {
+            if (k < m && missing[k] == i) {
+                k++;
+                continue;
+            }
+            size_t held_bytes;
+            const uint8_t* sym = held(first + i, held_bytes);
+            if (!sym) return true;  // Reused before the block was solved; up to ARQ now
+            for (int r = 0; r < m; r++) {
+                gf_mul_add(&syndromes[r * len], sym, min(held_bytes, len), fec_matrix[rows[r]][i]);
+            }
+        }
+
+        uint8_t a[FEC_MAX_REPAIR][FEC_MAX_REPAIR], inv[FEC_MAX_REPAIR][FEC_MAX_REPAIR];
+        for (int r = 0; r < m; r++) {
+            for (int c = 0; c < m; c++) a[r][c] = fec_matrix[rows[r]][missing[c]];
+        }
+        if (!gf_invert(a, inv, m)) return true;
+        for (int c = 0; c < m; c++) {
+            vector<uint8_t> sym(len, 0);
+            for (int r = 0; r < m; r++) {
+                gf_mul_add(sym.data(), &syndromes[r * len], len, inv[c][r]);
+            }
+            size_t payload_len = size_t(sym[0]) << 8 | sym[1];
+            if (payload_len > len - FEC_SYMBOL_PREFIX) return true;  // Inconsistent block
+            recovered.push_back(move(sym));
+            const uint8_t* rebuilt = recovered.back().data();
+            out.push_back({repair.conn_id, first + missing[c],
+                           reinterpret_cast<const char*>(rebuilt + FEC_SYMBOL_PREFIX), payload_len,
+                           (rebuilt[2] & FLAG_FIN) != 0, false, false, true, 0});
+        }
+        return true;
+    }
+public:
+    explicit FecDecoder(uint32_t capacity)
+        : symbols(size_t(capacity) * FEC_SYMBOL_SIZE), held_seq(capacity), held_len(capacity),
+          mask(capacity - 1) {}
+
+    // Keeps the symbol of a newly received data packet
+    void hold(const PacketView& pkt) {
+        uint32_t slot = pkt.seq_num & mask;
+        uint8_t* sym = &symbols[slot * FEC_SYMBOL_SIZE];
+        size_t len = min(pkt.payload_len, MAX_PAYLOAD_SIZE);
+        sym[0] = static_cast<uint8_t>(len >> 8);
+        sym[1] = static_cast<uint8_t>(len);
+        sym[2] = pkt.fin ? FLAG_FIN : 0;
+        sym[3] = 0;
+        memcpy(sym + FEC_SYMBOL_PREFIX, pkt.payload, len);
+        held_seq[slot] = pkt.seq_num;
+        held_len[slot] = static_cast<uint16_t>(FEC_SYMBOL_PREFIX + len);
+    }
+
+    // Takes one repair packet and appends whatever it lets the block
+    // rebuild to out. The rebuilt payloads stay valid until release().
+    void add_repair(const PacketView& pkt, const ReassemblyWindow& window, vector<PacketView>& out) {
+        uint32_t base = window.next_expected();
+        for (auto it = blocks.begin(); it != blocks.end();) {
+            if (seq_diff(it->first + it->second.data_count, base) <= 0) it = blocks.erase(it);
+            else ++it;
+        }
+
+        FecHeader fec;
+        memcpy(&fec, pkt.payload, sizeof(fec));
+        size_t len = pkt.payload_len - sizeof(fec);
+        if (fec.data_count == 0 || fec.data_count > FEC_MAX_DATA || fec.repair_count > FEC_MAX_REPAIR ||
+            fec.repair_index >= fec.repair_count || len > FEC_SYMBOL_SIZE) {
+            return;
+        }
+        uint32_t first = pkt.seq_num;
+        if (seq_diff(first + fec.data_count, base) <= 0) return;  // All in already
+
+        auto it = blocks.find(first);
+        if (it == blocks.end()) {
+            it = blocks.emplace(first, Block(fec.data_count, fec.repair_count, len)).first;
+        }
+        Block& block = it->second;
+        uint32_t bit = uint32_t(1) << fec.repair_index;
+        if (block.data_count != fec.data_count || block.repair_count != fec.repair_count ||
+            block.coded_len != len || (block.have & bit)) {
+            return;
+        }
+        block.have |= bit;
+        memcpy(&block.repairs[fec.repair_index * len], pkt.payload + sizeof(fec), len);
+        if (solve(first, block, pkt, window, out)) blocks.erase(it);
+    }
+
+    // The batch that rebuilt them has been written out
+    void release() { recovered.clear(); }
+};
+
+// Decides when the receiver acks: after every ack_every accepted packets or
+// once delay_us has passed since the first unacked one, whichever comes
+// first. Gaps and duplicates are acked immediately so the sender learns
+// about them without delay.
+class AckScheduler {
+    int ack_every;
+    uint64_t delay_us;
+    int pending = 0;
+    uint64_t first_pending_us = 0;
+public:
+    AckScheduler(int every, uint64_t delay) : ack_every(max(every, 1)), delay_us(delay) {}
+
+    // Records one accepted packet; true when an ACK should go out now
+    bool on_packet(bool immediate) {
+        if (pending++ == 0) first_pending_us = now_us();
+        return immediate || pending >= ack_every || delay_us == 0;
+    }
+
+    bool has_pending() const { return pending > 0; }
+
+    uint64_t time_left_us() const {
+        uint64_t deadline = first_pending_us + delay_us;
+        uint64_t now = now_us();
+        return deadline > now ? deadline - now : 0;
+    }
+
+    void sent() { pending = 0; }
+};
+
+// An --output file, shared by the sessions of one striped transfer. Each
+// writes its own range of the file through its own FileSink; the last one
+// to finish trims the file and closes it.
+class OutputFile {
+    mutex mtx;
+    int remaining;    // Stripes still writing
+    off_t size = 0;   // End of the furthest stripe
+    atomic<bool> closed{false};
+public:
+    const int fd;
+
+    OutputFile(const string& path, int stripes)
+        : remaining(stripes), fd(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)) {
+        if (fd < 0) handle_error("Cannot open output file " + path);
+    }
+
+    // One stripe is done and its data ends at end. Returns the file size if
+    // that closed the file, -1 otherwise.
+    off_t release(off_t end) {
+        lock_guard<mutex> lock(mtx);
+        size = max(size, end);
+        if (--remaining > 0) return -1;
+        if (ftruncate(fd, size) < 0) {
+            cerr << "[Receiver] ftruncate of output file failed: " << strerror(errno) << "\n";
+        }
+        fdatasync(fd);
+        close(fd);
+        closed = true;
+        return size;
+    }
+
+    bool is_closed() const { return closed; }
+};
+
+// One session's writer into an OutputFile. The payload of packet seq
+// belongs at seq * MAX_PAYLOAD_SIZE, so packets are written the moment they
+// arrive, in any order, and nothing is buffered for in-order delivery.
+// Contiguous payloads from one receive batch go out in a single pwritev();
+// space is reserved in FALLOCATE_EXTENT steps, and every SYNC_BATCH_BYTES of
+// new output starts writeback while waiting for the previous batch, so dirty
+// pages stay bounded however large the file gets.
+class FileSink {
+    shared_ptr<OutputFile> file;
+    int fd = -1;
+    vector<iovec> run;          // Contiguous payloads not written yet
+    off_t run_offset = 0;
+    off_t run_end = 0;
+    off_t allocated = 0;        // Space reserved up to here
+    off_t high_water = 0;       // End of the furthest payload written
+    off_t writeback_from = 0;   // Start of the range whose writeback is in flight
+    off_t writeback_to = 0;     // Everything below here has been handed to writeback
+    off_t final_size = -1;      // Known once the FIN packet is in
+    uint32_t fin_seq = 0;
+    bool fin_seen = false;
+    bool finished = false;
+
+    void reserve(off_t end) {
+        if (end <= allocated) return;
+        off_t extent = (end - allocated + FALLOCATE_EXTENT - 1) / FALLOCATE_EXTENT * FALLOCATE_EXTENT;
+        // Not every filesystem can preallocate; the writes work regardless
+        if (fallocate(fd, FALLOC_FL_KEEP_SIZE, allocated, extent) == 0) allocated += extent;
+        else allocated = end;
+    }
+
+    void write_run() {
+        size_t done = 0;
+        off_t offset = run_offset;
+        while (done < run.size()) {
+            ssize_t n = pwritev(fd, &run[done], min<size_t>(run.size() - done, IOV_MAX), offset);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                handle_error("pwritev to output file failed");
+            }
+            offset += n;
+            // Skip whatever was written completely, trim a partially written iovec
+            while (done < run.size() && static_cast<size_t>(n) >= run[done].iov_len) {
+                n -= run[done++].iov_len;
+            }
+            if (n > 0) {
+                run[done].iov_base = static_cast<char*>(run[done].iov_base) + n;
+                run[done].iov_len -= n;
+            }
+        }
+        high_water = max(high_water, run_end);
+        run.clear();
+    }
+
+    void maybe_writeback() {
+        if (high_water - writeback_to < SYNC_BATCH_BYTES) return;
+        sync_file_range(fd, writeback_to, high_water - writeback_to, SYNC_FILE_RANGE_WRITE);
+        if (writeback_to > writeback_from) {
+            sync_file_range(fd, writeback_from, writeback_to - writeback_from,
+                            SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                            SYNC_FILE_RANGE_WAIT_AFTER);
+        }
+        writeback_from = writeback_to;
+        writeback_to = high_water;
+    }
+public:
+    explicit FileSink(shared_ptr<OutputFile> output) : file(move(output)), fd(file->fd) {}
+    ~FileSink() { finish(); }
+
+    bool is_open() const { return fd >= 0; }
+
+    // Queues one payload; data must stay valid until commit()
+    void write(uint32_t seq_num, const char* data, size_t len, bool fin) {
+        if (finished) return;
+        off_t offset = off_t(seq_num) * MAX_PAYLOAD_SIZE;
+        if (fin) {
+            fin_seq = seq_num;
+            fin_seen = true;
+            final_size = offset + len;
+        }
+        if (len == 0) return;
+        if (run.empty() || offset != run_end) {
+            if (!run.empty()) write_run();
+            run_offset = run_end = offset;
+        }
+        reserve(offset + len);
+        run.push_back({const_cast<char*>(data), len});
+        run_end += len;
+    }
+
+    // Writes what the current batch queued. Finishes this session's part
+    // once every packet up to the FIN one is in (expected_seq_num is the
+    // first missing).
+    void commit(uint32_t expected_seq_num) {
+        if (!is_open() || finished) return;
+        if (!run.empty()) write_run();
+        maybe_writeback();
+        if (fin_seen && seq_before(fin_seq, expected_seq_num)) {
+            off_t size = finish();
+            if (size >= 0) cout << "[Receiver] Output complete: " << size << " bytes\n";
+        }
+    }
+
+    // Writes out the rest and hands the file back; returns its size if this
+    // was the last session writing it, -1 otherwise
+    off_t finish() {
+        if (!is_open() || finished) return -1;
+        if (!run.empty()) write_run();
+        finished = true;
+        fd = -1;
+        return file->release(final_size >= 0 ? final_size : high_water);
+    }
+};
+
+void process_received_data(FileSink* sink, uint32_t seq_num, const char* data, size_t len,
+                           bool fin = false) {
+    if (sink) sink->write(seq_num, data, len, fin);
+}
+
+// Receive state of one sender, keyed by the connection id it puts in every
+// packet. ACKs go to wherever its latest packet came from.
+struct Session {
+    uint32_t conn_id;
+    sockaddr_in peer;
+    uint32_t expected_seq_num = 0;  // First packet not yet received, the cumulative ACK
+    uint32_t echo_seq = 0;          // Latest data packet and its attempt, echoed in ACKs
+    uint8_t echo_attempt = 0;
+    uint32_t fin_seq = 0;           // The FIN packet, once seen
+    bool fin_seen = false;
+    ReassemblyWindow window;        // Selective Repeat only
+    AckScheduler acks;
+    ReceiverStats stats;
+    unique_ptr<FileSink> sink;
+    unique_ptr<FecDecoder> fec;     // Selective Repeat with repair packets only
+    uint64_t last_active_us = 0;
+    bool in_batch = false;          // Touched by the current receive batch
+    bool ack_now = false;           // ...and wants its ACK at the end of it
+    bool ack_delayed = false;       // On the table's delayed-ACK list
+    bool synced = false;            // Base taken from the SYN packet
+    bool in_flight = false;         // Counted among the table's sessions still receiving
+    int room_shares = 1;            // Sessions splitting the socket's room, as of this ACK
+
+    Session(uint32_t id, const sockaddr_in& source)
+        : conn_id(id), peer(source), window(options.window),
+          acks(options.ack_every, options.ack_delay_us) {}
+
+    // How far past cum_ack the sender may go: the packets already held
+    // beyond it plus its share of what the socket can still queue, within
+    // the reassembly window. Never 0, so the sender always has a packet to
+    // probe with.
+    int advertised_window(int room) const {
+        int held = static_cast<int>(window.held_count());
+        return max(min(held + room / room_shares, options.window), 1);
+    }
+
+    // Records a data packet for the echo in the next ACK
+    void on_data(const PacketView& pkt) {
+        echo_seq = pkt.seq_num;
+        echo_attempt = pkt.attempt;
+        if (pkt.fin) {
+            fin_seq = pkt.seq_num;
+            fin_seen = true;
+        }
+    }
+
+    // Synced and not yet past its FIN: more data is on the way
+    bool receiving() const {
+        return synced && !(fin_seen && seq_before(fin_seq, expected_seq_num));
+    }
+
+    // A session's sequence numbers start wherever its SYN packet says (a
+    // stripe starts partway into the transfer). Packets that overtake the
+    // SYN are refused unacked and the sender resends them.
+    bool sync(const PacketView& pkt) {
+        if (synced) return true;
+        if (!pkt.syn) return false;
+        expected_seq_num = pkt.seq_num;
+        window.reset(pkt.seq_num);
+        synced = true;
+        return true;
+    }
+};
+
+// Sends the session's cumulative ACK plus the SACK words describing what
+// arrived beyond it, echoing the data packet that prompted it.
+void send_ack(Transport& transport, const Session& session, const uint64_t* sack = nullptr,
+              int sack_words = 0) {
+    AckFrame frame;
+    frame.magic = htons(PACKET_MAGIC);
+    frame.version = PROTOCOL_VERSION;
+    frame.flags = FLAG_ACK;
+    frame.conn_id = htonl(session.conn_id);
+    frame.cum_ack = htonl(session.expected_seq_num);
+    frame.window = htons(static_cast<uint16_t>(session.advertised_window(transport.receive_room())));
+    frame.sack_words = htons(static_cast<uint16_t>(sack_words));
+    frame.echo_seq = htonl(session.echo_seq);
+    frame.echo_attempt = session.echo_attempt;
+    memset(frame.reserved, 0, sizeof(frame.reserved));
+    for (int i = 0; i < sack_words; i++) {
+        frame.sack[i] = htobe64(sack[i]);
+    }
+    transport.send(&frame, ACK_BASE_SIZE + sack_words * sizeof(uint64_t), session.peer);
+    if (options.verbose) {
+        cout << "[Receiver] Sent ACK: " << session.expected_seq_num << " (+" << sack_words << " SACK words)\n";
+    }
+}
+
+// Output files of the transfers in progress. Shared by all shards, since
+// address-hash steering can spread the stripes of one transfer over several.
+class OutputRegistry {
+    mutex mtx;
+    unordered_map<uint32_t, weak_ptr<OutputFile>> files;  // By transfer id
+    bool file_claimed = false;  // A plain --output file goes to one transfer
+public:
+    // The file conn_id's transfer writes to, opened by its first session.
+    // Null when a plain output file is already taken by another transfer,
+    // or this transfer's file is already complete.
+    shared_ptr<OutputFile> open(uint32_t conn_id) {
+        uint32_t transfer = transfer_of(conn_id);
+        lock_guard<mutex> lock(mtx);
+        shared_ptr<OutputFile> file = files[transfer].lock();
+        if (file) return file->is_closed() ? nullptr : file;
+
+        string path;
+        struct stat st;
+        if (stat(options.output.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+            char name[16];
+            snprintf(name, sizeof(name), "%06x.bin", transfer);
+            path = options.output + "/" + name;
+        } else if (!file_claimed) {
+            file_claimed = true;
+            path = options.output;
+        } else {
+            files.erase(transfer);
+            return nullptr;
+        }
+        file = make_shared<OutputFile>(path, stripes_of(conn_id));
+        files[transfer] = file;
+        return file;
+    }
+};
+
+OutputRegistry output_files;
+
+// Every live session by connection id, so concurrent senders on the port
+// each get their own sequence space. Consecutive packets in a batch mostly
+// come from one sender, so the last hit is checked before the hash map.
+// Sessions idle for SESSION_IDLE_US are closed and their stats folded into
+// the totals.
+class SessionTable {
+    unordered_map<uint32_t, Session> sessions;
+    Session* last = nullptr;
+    vector<Session*> batch;          // Touched since the last end_batch()
+    vector<Session*> delayed;        // Holding back an ACK until its deadline
+    uint64_t next_sweep_us = 0;
+    int opened = 0;
+    int in_flight = 0;               // Sessions still receiving, which share the socket's room
+    ReceiverStats closed_stats;
+
+    // Recounts session after its batch and tells it how many ways the
+    // room its ACK advertises is split
+    void update_flight(Session& session) {
+        bool receiving = session.receiving();
+        if (receiving != session.in_flight) {
+            session.in_flight = receiving;
+            in_flight += receiving ? 1 : -1;
+        }
+        session.room_shares = max(in_flight, 1);
+    }
+
+    // A directory given to --output gets one file per transfer, which its
+    // stripes share. A plain file goes to the first transfer; two senders
+    // cannot share one.
+    void open_output(Session& session) {
+        if (options.output.empty()) return;
+        shared_ptr<OutputFile> file = output_files.open(session.conn_id);
+        if (!file) {
+            cout << "[Receiver] Session " << hex << session.conn_id << dec
+                 << " not written, its output file is taken or complete\n";
+            return;
+        }
+        session.sink.reset(new FileSink(move(file)));
+    }
+
+    void close(Session& session, const char* reason) {
+        if (session.ack_delayed) {
+            delayed.erase(find(delayed.begin(), delayed.end(), &session));
+        }
+        if (last == &session) last = nullptr;
+        if (session.in_flight) in_flight--;
+        if (session.sink) session.sink->finish();
+        cout << "[Receiver] Session " << hex << session.conn_id << dec << " closed (" << reason
+             << "): " << session.stats.packets_received << " packets, "
+             << session.stats.total_bytes_received << " bytes\n";
+        closed_stats.merge(session.stats);
+    }
+public:
+    // The sender's session, created on its first packet
+    Session& get(uint32_t conn_id, const sockaddr_in& source, uint64_t now) {
+        Session* session = last;
+        if (!session || session->conn_id != conn_id) {
+            auto it = sessions.find(conn_id);
+            if (it == sessions.end()) {
+                it = sessions.emplace(piecewise_construct, forward_as_tuple(conn_id),
+                                      forward_as_tuple(conn_id, source)).first;
+                opened++;
+                char addr[INET_ADDRSTRLEN];
+                inet_ntop(AF_INET, &source.sin_addr, addr, sizeof(addr));
+                cout << "[Receiver] New session " << hex << conn_id << dec << " from "
+                     << addr << ":" << ntohs(source.sin_port) << "\n";
+                open_output(it->second);
+            }
+            session = last = &it->second;
+        }
+        session->peer = source;
+        session->last_active_us = now;
+        if (!session->in_batch) {
+            session->in_batch = true;
+            batch.push_back(session);
+        }
+        return *session;
+    }
+
+    // Visits every session the batch touched, once
+    template <typename Handler>
+    void end_batch(Handler handler) {
+        for (Session* session : batch) update_flight(*session);
+        for (Session* session : batch) {
+            session->in_batch = false;
+            handler(*session);
+            session->ack_now = false;
+        }
+        batch.clear();
+    }
+
+    // Remembers that session has an ACK due at its scheduler's deadline
+    void delay_ack(Session& session) {
+        if (session.ack_delayed) return;
+        session.ack_delayed = true;
+        delayed.push_back(&session);
+    }
+
+    // Time until the earliest delayed ACK is due, UINT64_MAX if none is
+    uint64_t ack_wait_us() const {
+        uint64_t wait = UINT64_MAX;
+        for (const Session* session : delayed) {
+            if (session->acks.has_pending()) wait = min(wait, session->acks.time_left_us());
+        }
+        return wait;
+    }
+
+    // Sends the delayed ACKs that are due and forgets the ones already sent
+    template <typename Sender>
+    void flush_due_acks(Sender send) {
+        for (size_t i = 0; i < delayed.size();) {
+            Session& session = *delayed[i];
+            bool due = session.acks.has_pending() && session.acks.time_left_us() == 0;
+            if (due) {
+                session.room_shares = max(in_flight, 1);
+                send(session);
+            }
+            if (due || !session.acks.has_pending()) {
+                session.ack_delayed = false;
+                delayed[i] = delayed.back();
+                delayed.pop_back();
+            } else {
+                i++;
+            }
+        }
+    }
+
+    void evict_idle(uint64_t now) {
+        if (now < next_sweep_us) return;
+        next_sweep_us = now + SESSION_SWEEP_US;
+        for (auto it = sessions.begin(); it != sessions.end();) {
+            if (now - it->second.last_active_us >= SESSION_IDLE_US) {
+                close(it->second, "idle");
+                it = sessions.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Closes every session and returns the stats of all sessions ever served
+    ReceiverStats close_all() {
+        for (auto& entry : sessions) close(entry.second, "shutdown");
+        sessions.clear();
+        cout << "[Receiver] Served " << opened << " session(s)\n";
+        return closed_stats;
+    }
+};
+
+// Mutex/condvar queue with one string per packet. The receiver used it
+// before PacketRing; it is kept as the baseline for --bench-queue.
+class PacketQueue {
+    deque<pair<int, string>> packets;
+    mutex mtx;
+    condition_variable cv;
+    size_t max_size;
+public:
+    explicit PacketQueue(size_t size = MAX_QUEUE_SIZE) : max_size(size) {}
+    
+    void push(int seq_num, string data) {
+        unique_lock<mutex> lock(mtx);
+        cv.wait(lock, [this]{ return packets.size() < max_size; });
+        packets.emplace_back(seq_num, move(data));
+        cv.notify_one();
+    }
+    
+    pair<int, string> pop() {
+        unique_lock<mutex> lock(mtx);
+        cv.wait(lock, [this]{ return !packets.empty() || !::running; });
+        if (!::running) throw runtime_error("Shutdown requested");
+        auto packet = move(packets.front());
+        packets.pop_front();
+        cv.notify_one();
+        return packet;
+    }
+};
+
+inline void cpu_relax() {
+#if defined(__x86_64__)
+    _mm_pause();
+#endif
+}
+
+inline void futex_wait(atomic<uint32_t>& word, uint32_t expected) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected,
+            nullptr, nullptr, 0);
+}
+
+inline void futex_wake(atomic<uint32_t>& word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, 1,
+            nullptr, nullptr, 0);
+}
+
+struct QueuedPacket {
+    uint32_t seq_num;
+    uint32_t len;
+    char data[MAX_PAYLOAD_SIZE];
+};
+
+// Bounded single-producer/single-consumer ring of preallocated packet slots
+// between the receive loop and packet_processor. Each side owns one index on
+// its own cache line and keeps a cached copy of the other's, so the shared
+// line is only read when the cached value runs out. The producer fills slots
+// and publishes a whole receive batch with one store; the consumer takes
+// everything published and releases it with one store. A side with nothing
+// to do spins for QUEUE_SPIN_ITERATIONS and then sleeps on a futex event
+// count, and the other side only pays for a wake-up when a waiting flag is
+// set. No lock is shared between the threads.
+class PacketRing {
+    // A futex word bumped on every wake-up, so a sleeper that read it before
+    // checking its condition cannot miss the change that satisfies it
+    struct Waiter {
+        atomic<uint32_t> event{0};
+        atomic<uint32_t> waiting{0};
+
+        template <typename Ready>
+        void wait(Ready ready) {
+            // Spinning only helps when the other side runs on another CPU
+            static const int spins = thread::hardware_concurrency() > 1 ? QUEUE_SPIN_ITERATIONS : 0;
+            for (int i = 0; i < spins; i++) {
+                if (ready()) return;
+                cpu_relax();
+            }
+            while (true) {
+                waiting.store(1);
+                uint32_t seen = event.load();
+                if (ready()) break;
+                futex_wait(event, seen);
+            }
+            waiting.store(0, memory_order_relaxed);
+        }
+
+        // Called after the state change the waiter is looking for
+        void notify() {
+            if (!waiting.load()) return;
+            event.fetch_add(1);
+            futex_wake(event);
+        }
+    };
+
+    vector<QueuedPacket> slots;
+    const uint32_t mask;
+
+    alignas(64) atomic<uint32_t> tail{0};    // Published by the producer
+    atomic<bool> closed{false};
+    Waiter consumer;
+    alignas(64) atomic<uint32_t> head{0};    // Released by the consumer
+    Waiter producer;
+
+    alignas(64) uint32_t write_pos = 0;      // Producer: next slot to fill
+    uint32_t cached_head = 0;
+    alignas(64) uint32_t read_pos = 0;       // Consumer: first unreleased slot
+    uint32_t cached_tail = 0;
+public:
+    explicit PacketRing(size_t capacity = MAX_QUEUE_SIZE)
+        : slots(round_up_pow2(capacity)), mask(slots.size() - 1) {}
+
+    // Producer: the next free slot, waiting for the consumer when the ring
+    // is full. Filled slots stay invisible until publish().
+    QueuedPacket& reserve() {
+        if (write_pos - cached_head == slots.size()) {
+            cached_head = head.load(memory_order_acquire);
+            if (write_pos - cached_head == slots.size()) {
+                publish();  // Let the consumer see what it has to drain
+                producer.wait([&]() {
+                    cached_head = head.load();
+                    return write_pos - cached_head < slots.size();
+                });
+            }
+        }
+        return slots[write_pos & mask];
+    }
+
+    void push_reserved() { write_pos++; }
+
+    // Producer: makes every filled slot visible in one store
+    void publish() {
+        if (tail.load(memory_order_relaxed) == write_pos) return;
+        tail.store(write_pos);
+        consumer.notify();
+    }
+
+    // Producer: publishes the rest; the consumer drains it and stops
+    void close() {
+        publish();
+        closed.store(true);
+        consumer.notify();
+    }
+
+    // Consumer: waits for published packets and returns how many are ready,
+    // or 0 once the ring is closed and drained
+    uint32_t wait_readable() {
+        if (cached_tail == read_pos) {
+            consumer.wait([&]() {
+                cached_tail = tail.load();
+                return cached_tail != read_pos || closed.load();
+            });
+            cached_tail = tail.load(memory_order_acquire);
+        }
+        return cached_tail - read_pos;
+    }
+
+    const QueuedPacket& peek(uint32_t i) const { return slots[(read_pos + i) & mask]; }
+
+    // Consumer: hands n slots back to the producer in one store
+    void consume(uint32_t n) {
+        read_pos += n;
+        head.store(read_pos);
+        producer.notify();
+    }
+};
+
+void packet_processor(PacketRing& ring, ReceiverStats& stats) {
+    while (uint32_t ready = ring.wait_readable()) {
+        for (uint32_t i = 0; i < ready; i++) {
+            const QueuedPacket& packet = ring.peek(i);
+            process_received_data(nullptr, packet.seq_num, packet.data, packet.len);
+            stats.total_bytes_received += packet.len;
+        }
+        ring.consume(ready);
+    }
+}
+
+uint64_t now_ns() {
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// --bench-queue adapters with a common push/flush/drain/close interface.
+// Both copy a full payload per packet, as the receive loop does.
+struct LockedQueueBench {
+    PacketQueue queue;
+
+    void push(uint32_t seq_num, const char* payload) {
+        queue.push(seq_num, string(payload, MAX_PAYLOAD_SIZE));
+    }
+    void flush() {}
+    template <typename Handler>
+    void drain(Handler on_packet) {
+        auto packet = queue.pop();
+        on_packet(packet.second.data());
+    }
+    void close() {}
+};
+
+struct PacketRingBench {
+    PacketRing ring;
+
+    void push(uint32_t seq_num, const char* payload) {
+        QueuedPacket& slot = ring.reserve();
+        slot.seq_num = seq_num;
+        slot.len = MAX_PAYLOAD_SIZE;
+        memcpy(slot.data, payload, MAX_PAYLOAD_SIZE);
+        ring.push_reserved();
+    }
+    void flush() { ring.publish(); }
+    template <typename Handler>
+    void drain(Handler on_packet) {
+        uint32_t ready = ring.wait_readable();
+        for (uint32_t i = 0; i < ready; i++) on_packet(ring.peek(i).data);
+        ring.consume(ready);
+    }
+    void close() { ring.close(); }
+};
+
+// Hands count packets from this thread to a consumer thread, each stamped
+// with its push time. Publishes every batch_size packets, or after each one
+// when paced. Returns the handoff latencies in ns and the elapsed time.
+template <typename Bench>
+vector<uint64_t> run_queue_handoff(int count, int batch_size, uint64_t interval_ns, double& secs) {
+    Bench bench;
+    vector<uint64_t> latencies(count);
+    thread consumer([&]() {
+        int received = 0;
+        while (received < count) {
+            bench.drain([&](const char* payload) {
+                uint64_t stamp;
+                memcpy(&stamp, payload, sizeof(stamp));
+                latencies[received++] = now_ns() - stamp;
+            });
+        }
+    });
+
+    char payload[MAX_PAYLOAD_SIZE] = {};
+    uint64_t start = now_ns();
+    for (int i = 0; i < count; i++) {
+        if (interval_ns) {
+            while (now_ns() < start + i * interval_ns) cpu_relax();
+        }
+        uint64_t stamp = now_ns();
+        memcpy(payload, &stamp, sizeof(stamp));
+        bench.push(i, payload);
+        if (interval_ns || (i + 1) % batch_size == 0) bench.flush();
+    }
+    bench.flush();
+    consumer.join();
+    bench.close();
+    secs = (now_ns() - start) / 1e9;
+    return latencies;
+}
+
+template <typename Bench>
+void report_queue_benchmark(const char* name, bool paced) {
+    double secs;
+    run_queue_handoff<Bench>(BENCH_QUEUE_PACKETS, options.batch_size, 0, secs);
+    double mpps = BENCH_QUEUE_PACKETS / secs / 1e6;
+    if (!paced) {
+        cout << name << " | " << mpps << " Mpkt/s (batches of " << options.batch_size << ")\n";
+        return;
+    }
+    vector<uint64_t> latencies = run_queue_handoff<Bench>(BENCH_QUEUE_PACED, 1, BENCH_QUEUE_INTERVAL_NS, secs);
+    sort(latencies.begin(), latencies.end());
+    auto pct = [&](double p) { return latencies[static_cast<size_t>(p * (latencies.size() - 1))]; };
+    cout << name << " | " << mpps << " Mpkt/s (batches of " << options.batch_size << ")"
+         << " | paced handoff (ns): p50 " << pct(0.50) << " | p99 " << pct(0.99)
+         << " | max " << latencies.back() << "\n";
+}
+
+// Compares the receive-to-processor handoff of the old mutex queue and
+// PacketRing: flat-out throughput, then latency with one packet every
+// BENCH_QUEUE_INTERVAL_NS. The paced producer spins between packets, so on
+// a single CPU the consumer only runs when the producer is preempted and
+// the latency measured would be the scheduler's time slice; it is skipped.
+void run_queue_benchmark() {
+    cout << "=== Packet Queue Benchmark (" << MAX_PAYLOAD_SIZE << "-byte payloads) ===\n";
+    bool paced = thread::hardware_concurrency() >= 2;
+    if (!paced) cout << "Single CPU: paced handoff latency skipped, it would time the scheduler\n";
+    report_queue_benchmark<LockedQueueBench>("mutex queue", paced);
+    report_queue_benchmark<PacketRingBench>("spsc ring  ", paced);
+}
+
+ReceiverStats stop_and_wait_receiver(int sock) {
+    unique_ptr<Transport> transport = make_transport(sock);
+    
+    ReceiverStats stats;
+    SessionTable sessions;
+    int timeout_count = 0;
+    const int MAX_TIMEOUTS = 5;
+    cout << "[Receiver] Started in Stop-and-Wait mode. Waiting for packets...\n";
+
+    // The io_uring backend handles payloads inline on its single thread, and
+    // so does a file sink, which needs to know when everything has been written
+    bool inline_processing = options.backend == BACKEND_IO_URING || !options.output.empty();
+    PacketRing packet_ring;
+    thread processor;
+    if (!inline_processing) processor = thread(packet_processor, ref(packet_ring), ref(stats));
+    
+    while (timeout_count < MAX_TIMEOUTS && running) {
+        int received = transport->receive(stats);
+        if (received < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                timeout_count++;
+                cout << "[Receiver] Timeout " << timeout_count << "/" << MAX_TIMEOUTS << endl;
+                sessions.evict_idle(now_us());
+                continue;
+            }
+            if (errno == EINTR) continue;
+            handle_error("recvmmsg failed");
+        }
+
+        timeout_count = 0;
+        uint64_t now = now_us();
+
+        for (int i = 0; i < received; i++) {
+            const Datagram& dgram = transport->datagram(i);
+            PacketView pkt;
+            if (!validate_packet(dgram.data, dgram.len, pkt)) {
+                stats.corrupted_packets++;
+                cerr << "[Receiver] Invalid packet received\n";
+                continue;
+            }
+            Session& session = sessions.get(pkt.conn_id, *dgram.source, now);
+            if (!session.sync(pkt)) {
+                session.stats.out_of_window++;
+                if (options.verbose) cout << "[Receiver] Packet " << pkt.seq_num << " ahead of the SYN, dropped\n";
+                continue;
+            }
+            if (pkt.repair) {
+                session.stats.repair_packets++;  // Only a Selective Repeat receiver uses them
+                continue;
+            }
+            uint32_t seq_num = pkt.seq_num;
+            if (options.verbose) cout << "[Receiver] Received packet " << seq_num << "\n";
+            session.stats.packets_received++;
+            session.on_data(pkt);
+            if (inline_processing) {
+                process_received_data(session.sink.get(), seq_num, pkt.payload, pkt.payload_len, pkt.fin);
+                session.stats.total_bytes_received += pkt.payload_len;
+            } else {
+                QueuedPacket& slot = packet_ring.reserve();
+                slot.seq_num = seq_num;
+                slot.len = min(pkt.payload_len, MAX_PAYLOAD_SIZE);
+                memcpy(slot.data, pkt.payload, slot.len);
+                packet_ring.push_reserved();
+            }
+
+            if (seq_num == session.expected_seq_num) {
+                session.expected_seq_num++;
+            } else {
+                session.stats.out_of_order++;
+                if (options.verbose) {
+                    cout << "[Receiver] Out of order packet. Expected "
+                         << session.expected_seq_num << ", got " << seq_num << "\n";
+                }
+            }
+        }
+        packet_ring.publish();
+        // One ACK per sender for its share of the batch
+        sessions.end_batch([&](Session& session) {
+            if (!session.synced) return;
+            if (session.sink) session.sink->commit(session.expected_seq_num);
+            send_ack(*transport, session);
+            session.stats.acks_sent++;
+        });
+        sessions.evict_idle(now);
+    }
+
+    packet_ring.close();
+    if (processor.joinable()) processor.join();
+    cout << "[Receiver] Terminating due to " << MAX_TIMEOUTS << " consecutive timeouts\n";
+    stats.merge(sessions.close_all());
+    return stats;
+}
+
+// Shared loop of the windowed receivers. accept(session, pkt) applies one
+// valid packet and returns whether it should be acked immediately (for a
+// repair packet, whether it rebuilt any);
+// flush_ack(session) sends that session's ACK. Each batch costs every
+// sender at most one ACK, and delayed ACKs go out at their deadline even
+// while other senders keep the socket busy.
+template <typename Accept, typename FlushAck>
+ReceiverStats run_windowed_receiver(Transport& transport, ReceiverStats& stats, Accept accept,
+                           FlushAck flush_ack) {
+    SessionTable sessions;
+    while (running) {
+        uint64_t wait_us = sessions.ack_wait_us();
+        if (wait_us != UINT64_MAX && !transport.wait_readable(wait_us)) {
+            sessions.flush_due_acks(flush_ack);
+            sessions.evict_idle(now_us());
+            continue;
+        }
+
+        int received = transport.receive(stats);
+        uint64_t now = now_us();
+        for (int i = 0; i < received; i++) {
+            const Datagram& dgram = transport.datagram(i);
+            PacketView pkt;
+            if (!validate_packet(dgram.data, dgram.len, pkt)) {
+                stats.corrupted_packets++;
+                cerr << "[Receiver] Invalid packet received\n";
+                continue;
+            }
+            Session& session = sessions.get(pkt.conn_id, *dgram.source, now);
+            if (!session.sync(pkt)) {
+                session.stats.out_of_window++;
+                if (options.verbose) cout << "[Receiver] Packet " << pkt.seq_num << " ahead of the SYN, dropped\n";
+                continue;
+            }
+            if (pkt.repair) {
+                // Acked only if it rebuilt something
+                session.stats.repair_packets++;
+                if (accept(session, pkt)) session.ack_now |= session.acks.on_packet(true);
+                continue;
+            }
+            if (options.verbose) cout << "[Receiver] Received packet " << pkt.seq_num << "\n";
+            session.stats.packets_received++;
+            session.stats.total_bytes_received += pkt.payload_len;
+            session.on_data(pkt);
+            session.ack_now |= session.acks.on_packet(accept(session, pkt));
+        }
+        sessions.end_batch([&](Session& session) {
+            if (session.sink) session.sink->commit(session.expected_seq_num);
+            if (session.fec) session.fec->release();
+            if (session.ack_now) {
+                flush_ack(session);
+            } else if (session.acks.has_pending()) {
+                sessions.delay_ack(session);
+            }
+        });
+        sessions.flush_due_acks(flush_ack);
+        sessions.evict_idle(now);
+    }
+
+    stats.merge(sessions.close_all());
+    return stats;
+}
+
+ReceiverStats go_back_n_receiver(int sock) {
+    unique_ptr<Transport> transport = make_transport(sock);
+    ReceiverStats stats;
+    cout << "[Receiver] Started in Go-Back-N mode. Waiting for packets...\n";
+
+    // Nothing is held past a gap, so expected_seq_num is all the state there is
+    auto accept = [](Session& session, const PacketView& pkt) {
+        if (pkt.repair) return false;  // Nothing past a gap is kept to combine it with
+        bool in_order = pkt.seq_num == session.expected_seq_num;
+        if (in_order) {
+            process_received_data(session.sink.get(), pkt.seq_num, pkt.payload, pkt.payload_len, pkt.fin);
+            session.expected_seq_num++;
+        } else {
+            session.stats.out_of_order++;
+            if (options.verbose) {
+                cout << "[Receiver] Out of order packet. Expected "
+                     << session.expected_seq_num << ", got " << pkt.seq_num << "\n";
+            }
+        }
+        // Duplicates are re-acked too, in case the earlier ACK was lost
+        return !in_order;
+    };
+    auto flush_ack = [&](Session& session) {
+        send_ack(*transport, session);
+        session.stats.acks_sent++;
+        session.acks.sent();
+    };
+    return run_windowed_receiver(*transport, stats, accept, flush_ack);
+}
+
+ReceiverStats selective_repeat_receiver(int sock) {
+    unique_ptr<Transport> transport = make_transport(sock);
+    ReceiverStats stats;
+    cout << "[Receiver] Started in Selective Repeat mode. Waiting for packets...\n";
+
+    auto accept_data = [](Session& session, const PacketView& pkt) {
+        uint32_t seq_num = pkt.seq_num;
+        uint32_t previous_expected = session.expected_seq_num;
+        uint32_t delivered = 0;
+        if (session.window.in_window(seq_num)) {
+            // Written straight to its file offset, so nothing is held for reordering
+            if (session.window.insert(seq_num)) {
+                process_received_data(session.sink.get(), seq_num, pkt.payload, pkt.payload_len, pkt.fin);
+                if (pkt.fec) {
+                    if (!session.fec) session.fec.reset(new FecDecoder(session.window.capacity()));
+                    session.fec->hold(pkt);
+                }
+            }
+            delivered = session.window.advance();
+            session.expected_seq_num = session.window.next_expected();
+            for (uint32_t k = 0; options.verbose && k < delivered; k++) {
+                cout << "[Receiver] Delivering packet " << previous_expected + k << "\n";
+            }
+        } else if (seq_before(seq_num, previous_expected)) {
+            session.stats.out_of_order++;
+            if (options.verbose) cout << "[Receiver] Out of order packet " << seq_num << "\n";
+        } else {
+            // The sender overran the advertised window; the ACK tells it where we are
+            session.stats.out_of_window++;
+            if (options.verbose) {
+                cout << "[Receiver] Packet " << seq_num << " beyond window "
+                     << previous_expected << "+" << session.window.capacity() << "\n";
+            }
+        }
+        // Ack at once when a gap opens, a duplicate arrives or a gap is filled
+        return seq_num != previous_expected || delivered > 1;
+    };
+    // Packets a repair packet rebuilds go through accept_data() as if they
+    // had just arrived, and are acked at once
+    vector<PacketView> rebuilt;
+    auto accept = [&](Session& session, const PacketView& pkt) {
+        if (!pkt.repair) return accept_data(session, pkt);
+        if (!session.fec) return false;
+        rebuilt.clear();
+        session.fec->add_repair(pkt, session.window, rebuilt);
+        for (const PacketView& packet : rebuilt) {
+            if (options.verbose) cout << "[Receiver] Recovered packet " << packet.seq_num << " from FEC\n";
+            session.stats.fec_recovered++;
+            session.stats.total_bytes_received += packet.payload_len;
+            accept_data(session, packet);
+        }
+        return !rebuilt.empty();
+    };
+    auto flush_ack = [&](Session& session) {
+        uint64_t sack[MAX_SACK_WORDS];
+        int sack_words = session.window.build_sack(sack);
+        send_ack(*transport, session, sack, sack_words);
+        session.stats.acks_sent++;
+        session.acks.sent();
+    };
+    return run_windowed_receiver(*transport, stats, accept, flush_ack);
+}
+
+// Steers each datagram to shard transfer_of(conn_id) % shards, so all
+// stripes of a transfer meet on one shard. The program sees the UDP
+// payload, so it reads the connection id straight from the packet header;
+// its result indexes the group's sockets in bind order.
+void attach_conn_id_steering(int sock, int shards) {
+    sock_filter code[] = {
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(PacketHeader, conn_id)),
+        BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 8),
+        BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, static_cast<uint32_t>(shards)),
+        BPF_STMT(BPF_RET | BPF_A, 0),
+    };
+    sock_fprog prog = {static_cast<unsigned short>(sizeof(code) / sizeof(code[0])), code};
+    if (setsockopt(sock, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) < 0) {
+        cerr << "[Receiver] SO_ATTACH_REUSEPORT_CBPF failed (" << strerror(errno)
+             << "), steering by address hash\n";
+    }
+}
+
+void pin_to_cpu(unsigned cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+ReceiverStats run_receiver(Protocol protocol, int sock) {
+    if (protocol == STOP_AND_WAIT) {
+        return stop_and_wait_receiver(sock);
+    } else if (protocol == GO_BACK_N) {
+        return go_back_n_receiver(sock);
+    } else {
+        return selective_repeat_receiver(sock);
+    }
+}
+
+// With --shards=N, N threads pinned to consecutive cores each run the whole
+// receiver on their own socket in one SO_REUSEPORT group: transport,
+// session table, reassembly and ACKs. A sender's packets all land on one
+// shard (same source address, or same transfer id with conn-id steering),
+// so the shards share nothing but the port and the output files of striped
+// transfers.
+void receiver(Protocol protocol) {
+    if (options.shards <= 1) {
+        run_receiver(protocol, create_receiver_socket()).print();
+        return;
+    }
+
+    // Bind order fixes each socket's index in the group, which is what the
+    // steering program returns
+    vector<int> socks;
+    for (int i = 0; i < options.shards; i++) {
+        socks.push_back(create_receiver_socket(true));
+    }
+    if (options.steering == STEER_CONN_ID) attach_conn_id_steering(socks[0], options.shards);
+    cout << "[Receiver] Running " << options.shards << " shards\n";
+
+    vector<ReceiverStats> results(options.shards);
+    vector<thread> workers;
+    unsigned cpus = max(thread::hardware_concurrency(), 1u);
+    for (int i = 0; i < options.shards; i++) {
+        workers.emplace_back([&, i]() {
+            pin_to_cpu(i % cpus);
+            results[i] = run_receiver(protocol, socks[i]);
+        });
+    }
+    ReceiverStats total;
+    for (int i = 0; i < options.shards; i++) {
+        workers[i].join();
+        results[i].print("Shard " + to_string(i));
+        total.merge(results[i]);
+    }
+    total.print();
+}
+
+void print_usage(const char* prog) {
+    cout << "Usage: " << prog << " [--quiet] [--ack-every=N] [--ack-delay-us=T] [--batch=N] [--gro]\n"
+         << "       [--backend=socket|io_uring] [--sqpoll]\n"
+         << "       [--output=PATH] [--window=N] [--shards=N] [--steer=hash|conn-id]\n"
+         << "       " << prog << " [--batch=N] --bench-queue\n"
+         << "  --quiet           Suppress per-packet log lines\n"
+         << "  --ack-every=N     ACK after N in-order packets (default " << ReceiverOptions().ack_every << ")\n"
+         << "  --ack-delay-us=T  ...or T microseconds after the first unacked one (default "
+         << ReceiverOptions().ack_delay_us << ")\n"
+         << "  --batch=N         Datagrams per recvmmsg() call (default " << ReceiverOptions().batch_size << ")\n"
+         << "  --gro             Accept kernel-coalesced datagrams (UDP_GRO)\n"
+         << "  --backend=B       Transport: socket (default) or io_uring\n"
+         << "  --sqpoll          With io_uring, submit from a kernel polling thread\n"
+         << "  --output=PATH     Write the received payloads to PATH, or with a directory, one\n"
+         << "                    file per transfer (<transfer id>.bin) inside it\n"
+         << "  --window=N        Selective Repeat reassembly window in packets, rounded up to a\n"
+         << "                    power of two in [" << MIN_RECV_WINDOW << ", " << MAX_RECV_WINDOW
+         << "] (default " << ReceiverOptions().window << ")\n"
+         << "  --shards=N        Receive on N SO_REUSEPORT sockets, one pinned thread each\n"
+         << "  --steer=S         Spread senders over shards by source address (hash, default)\n"
+         << "                    or by transfer id (conn-id, a cBPF program)\n"
+         << "  --bench-queue     Compare the packet handoff queues and exit\n";
+}
+
+bool parse_options(int argc, char* argv[], bool& bench_queue) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        string key = arg.substr(0, eq);
+        string value = eq == string::npos ? "" : arg.substr(eq + 1);
+        try {
+            if (key == "--quiet") {
+                options.verbose = false;
+            } else if (key == "--ack-every") {
+                options.ack_every = stoi(value);
+            } else if (key == "--ack-delay-us") {
+                options.ack_delay_us = stoull(value);
+            } else if (key == "--batch") {
+                options.batch_size = max(stoi(value), 1);
+            } else if (key == "--gro") {
+                options.gro = true;
+            } else if (key == "--backend" && (value == "socket" || value == "io_uring")) {
+                options.backend = value == "io_uring" ? BACKEND_IO_URING : BACKEND_SOCKET;
+            } else if (key == "--sqpoll") {
+                options.sqpoll = true;
+            } else if (key == "--output" && !value.empty()) {
+                options.output = value;
+            } else if (key == "--window") {
+                int window = min(max(stoi(value), MIN_RECV_WINDOW), MAX_RECV_WINDOW);
+                options.window = static_cast<int>(round_up_pow2(window));
+            } else if (key == "--shards") {
+                options.shards = max(stoi(value), 1);
+            } else if (key == "--steer" && (value == "hash" || value == "conn-id")) {
+                options.steering = value == "conn-id" ? STEER_CONN_ID : STEER_HASH;
+            } else if (key == "--bench-queue") {
+                bench_queue = true;
+            } else {
+                return false;
+            }
+        } catch (const exception&) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    init_checksum();
+    init_fec();
+    bool bench_queue = false;
+    if (!parse_options(argc, argv, bench_queue)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (bench_queue) {
+        run_queue_benchmark();
+        return 0;
+    }
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
 
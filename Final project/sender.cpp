@@ -1,5 +1,4 @@
 #include <iostream>
-#include <thread>
 #include <chrono>
 #include <cstring>
 #include <arpa/inet.h>
@@ -7,467 +6,2939 @@
 #include <unistd.h>
 #include <vector>
 #include <random>
-#include <atomic>
 #include <mutex>
 #include <string>
 #include <fstream>
+#include <climits>
+#include <endian.h>
+#include <sys/timerfd.h>
+#include <sys/epoll.h>
+#include <fcntl.h>
+#include <netinet/udp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include <algorithm>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <linux/net_tstamp.h>
+#include <linux/rtnetlink.h>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#include <immintrin.h>
+#endif
 
 using namespace std;  // Move this before any string usage
 
 const int PORT = 8080;
-const int TIMEOUT = 3;
 const char* DEFAULT_IP = "192.168.0.109";  // Changed from string to char*
 const int PACKET_SIZE = 1024;
 const int MAX_BUFFER_SIZE = 1024;
 const int MAX_RETRIES = 5;
 const int SEND_BUFFER_SIZE = 8192;  // Larger buffer for better performance
-const int MIN_TIMEOUT_MS = 100;     // Minimum timeout in milliseconds
-const int MAX_TIMEOUT_MS = 5000;    // Maximum timeout in milliseconds
+const int GSO_SEND_BUFFER_SIZE = 1 << 20;  // Room for several 64 KB GSO messages
+const size_t GSO_MAX_SEGMENTS = 64;        // Kernel limit on segments per UDP_SEGMENT send
+const size_t GSO_MAX_BYTES = 65507;        // Largest UDP payload over IPv4
+const unsigned URING_ENTRIES = 256;        // Submission queue depth of the io_uring backend
+const unsigned URING_CQ_FACTOR = 8;        // Completion queue size relative to it
+const unsigned URING_ACK_BUFFERS = 64;     // Provided buffers for incoming ACK frames
+const unsigned URING_SQPOLL_IDLE_MS = 1000;
+
+enum Backend {
+    BACKEND_SOCKET,     // epoll, timerfd and sendmmsg()
+    BACKEND_IO_URING    // sendmsg SQEs, multishot recvmsg for ACKs, IORING_OP_TIMEOUT for the RTO
+};
+
+enum CongestionAlgorithm {
+    CC_NONE,      // In flight is limited by the window alone
+    CC_NEWRENO,   // RFC 5681/6582 AIMD
+    CC_CUBIC      // RFC 9438
+};
+const char* const CONGESTION_ALGORITHM_NAMES[] = {"none", "newreno", "cubic"};
+
+enum PacingMode {
+    PACING_OFF,
+    PACING_TXTIME,  // A departure time on every packet (SO_TXTIME), kept by the fq or etf qdisc
+    PACING_RATE,    // SO_MAX_PACING_RATE on the socket, kept by fq
+    PACING_USER     // The send loop holds packets back itself and sleeps on its timer
+};
+const char* const PACING_MODE_NAMES[] = {"off", "txtime", "rate", "user"};
+const double PACING_GAIN_SLOW_START = 2.0;  // --pace=auto: rate relative to cwnd / srtt...
+const double PACING_GAIN = 1.25;            // ...and once out of slow start
+const uint64_t PACING_SLACK_US = 100;       // User-space pacer sends whatever is due this soon
+const int DUPACK_THRESHOLD = 3;   // Later packets acked before one is presumed lost (RFC 5681)
+const double INITIAL_CWND = 10;           // Packets (RFC 6928)
+const double MIN_CWND = 2;                // Floor for ssthresh after a loss
+const double CUBIC_C = 0.4;
+const double CUBIC_BETA = 0.7;
+const uint64_t TRACE_INTERVAL_US = 10000;  // cwnd and window sampled this often for stat.txt...
+const size_t MAX_TRACE_SAMPLES = 1000;     // ...and thinned out past this many
+const int AUTO_WINDOW_MAX = 32768;        // Ring size with an auto-tuned window, the most a receiver advertises
+const int AUTO_WINDOW_INITIAL = 10;       // Packets, until the first delivery-rate sample
+const int AUTO_WINDOW_MIN = 4;            // Enough to keep fast retransmit working
+const double AUTO_WINDOW_GAIN = 2.0;      // Window over the measured bandwidth-delay product
+const int DELIVERY_RATE_ROUNDS = 10;      // Bottleneck rate is the best sample over this many rounds
+const uint64_t MIN_RTT_EXPIRY_US = 10000000;  // A min RTT this old is replaced by the next sample
+const uint64_t INITIAL_RTO_US = 1000000;  // RTO before the first RTT sample (RFC 6298)
+const uint64_t MIN_RTO_US = 1000;         // Lower bound on the retransmission timeout
+const uint64_t MAX_RTO_US = 5000000;      // Cap on the backed-off retransmission timeout
+const uint64_t TIMER_TICK_US = 100;       // Timer wheel resolution
+const uint64_t PEER_ACK_DELAY_US = 200;   // Longest the receiver holds an ACK back (its default --ack-delay-us)
+const size_t HUGE_PAGE_SIZE = 2 << 20;
+const size_t MAX_LOGGED_LOSSES = 1000;    // Lost sequence numbers listed in stat.txt
+const int MAX_STRIPES = 16;               // The stripe index is four bits of the connection id
+const double FEC_LOSS_GAIN = 0.125;       // EWMA weight of one block in the FEC loss estimate
+const double LOSS_CHECK_RATIO = 1.1;      // --loss-check: recoveries allowed per simulated loss...
+const int LOSS_CHECK_SLACK = 5;           // ...plus this many for scheduling hiccups
+
+// Wire format (shared with receiver.cpp). Multi-byte fields are big-endian.
+const uint16_t PACKET_MAGIC = 0x5357;  // "SW"
+const uint8_t PROTOCOL_VERSION = 3;
+const uint8_t FLAG_DATA = 0x01;
+const uint8_t FLAG_ACK = 0x02;
+const uint8_t FLAG_FIN = 0x04;   // Set on the last data packet of a transfer
+const uint8_t FLAG_SYN = 0x08;   // Set on the first data packet of a session, fixes its base
+const uint8_t FLAG_REPAIR = 0x10;  // FEC repair packet: FecHeader and a coding symbol, never acked
+const uint8_t FLAG_FEC = 0x20;     // Data packet of a session that sends repair packets
+
+struct __attribute__((packed)) PacketHeader {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t flags;
+    uint32_t conn_id;
+    uint32_t seq_num;
+    uint16_t payload_len;
+    uint8_t checksum_type;
+    uint8_t attempt;      // Retransmission count, saturating at 255
+    uint32_t checksum;
+};
+
+const int MAX_SACK_WORDS = 16;  // SACK bitmap covers up to 1024 packets past cum_ack
+
+// Cumulative ACK plus a selective-ack bitmap. Bit i of the bitmap (word i / 64,
+// most significant bit first within the frame) means cum_ack + 1 + i arrived.
+// Only the leading non-zero words are sent.
+struct __attribute__((packed)) AckFrame {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t flags;
+    uint32_t conn_id;
+    uint32_t cum_ack;     // Every sequence number below this has arrived
+    uint16_t window;      // Packets the receiver can take past cum_ack right now
+    uint16_t sack_words;
+    uint32_t echo_seq;    // Latest data packet received, the one that prompted this ACK...
+    uint8_t echo_attempt; // ...and its attempt field, so the sender can time that transmission
+    uint8_t reserved[3];
+    uint64_t sack[MAX_SACK_WORDS];
+};
+
+const size_t ACK_BASE_SIZE = offsetof(AckFrame, sack);
+
+const size_t HEADER_SIZE = sizeof(PacketHeader);
+const size_t MAX_PAYLOAD_SIZE = PACKET_SIZE - HEADER_SIZE;
+
+// Payload of a repair packet. Its seq_num is the first data packet of the
+// block it covers; the coding symbol follows the FecHeader.
+struct __attribute__((packed)) FecHeader {
+    uint8_t data_count;    // Data packets in the block
+    uint8_t repair_index;  // Row of fec_matrix this symbol was coded with
+    uint8_t repair_count;  // Repair packets sent for the block
+    uint8_t reserved;
+};
+
+// A data packet's coding symbol is its payload length (big-endian), its FIN
+// flag and a pad byte, then the payload, zero-padded to the longest symbol
+// of the block. A repair packet carries just that many bytes.
+const size_t FEC_SYMBOL_PREFIX = 4;
+const size_t FEC_SYMBOL_SIZE = FEC_SYMBOL_PREFIX + MAX_PAYLOAD_SIZE;
+const size_t REPAIR_PACKET_SIZE = HEADER_SIZE + sizeof(FecHeader) + FEC_SYMBOL_SIZE;
+const int FEC_MAX_DATA = 128;   // Data packets per block
+const int FEC_MAX_REPAIR = 16;  // Repair packets per block
+
+// A striped transfer runs one session per stripe. Their connection ids share
+// the upper 24 bits (the transfer id), bits 4-7 hold the stripe count minus
+// one and bits 0-3 the stripe index.
+inline uint32_t stripe_conn_id(uint32_t transfer_conn_id, int stripes, int index) {
+    return (transfer_conn_id & ~0xFFu) | uint32_t(stripes - 1) << 4 | uint32_t(index);
+}
+
+// Serial-number arithmetic (RFC 1982) on 32-bit sequence numbers: a is
+// before b if it is less than half the sequence space behind it, so the
+// comparison keeps working after seq wraps around
+inline int32_t seq_diff(uint32_t a, uint32_t b) {
+    return static_cast<int32_t>(a - b);
+}
+
+inline bool seq_before(uint32_t a, uint32_t b) {
+    return seq_diff(a, b) < 0;
+}
+
+// Command-line tunables, see print_usage()
+struct SenderOptions {
+    bool verbose = true;  // Per-packet log lines
+    int batch_size = 32;  // Datagrams per sendmmsg() call
+    bool gso = false;     // Send full PACKET_SIZE datagrams through UDP_SEGMENT
+    Backend backend = BACKEND_SOCKET;
+    CongestionAlgorithm cc = CC_NONE;
+    double pace_mbps = 0;     // Fixed pacing rate for the whole transfer...
+    bool pace_auto = false;   // ...or one derived from cwnd and the RTT
+    PacingMode pacer = PACING_OFF;  // Pacing mechanism, detected when left off
+    string file;          // Send this file instead of generated packets
+    bool huge_pages = false;  // Back the packet pool with MAP_HUGETLB
+    int stripes = 1;      // Sockets and threads the transfer is split across
+    int fec_block = 0;    // Data packets per FEC block, 0 for no repair packets
+    int fec_repairs = 0;  // Repair packets per block, 0 to follow the loss rate
+    bool auto_window = false;  // Size the window from the measured bandwidth-delay product
+    bool loss_check = false;   // Fail if retransmissions outrun the simulated losses
+};
+
+SenderOptions options;
+uint32_t connection_id = 0;  // Picked at startup; each stripe's id is derived from it
+
+// Utility functions
+void handle_error(const string& msg) {
+    cerr << "[ERROR] " << msg << ": " << strerror(errno) << endl;
+    exit(1);
+}
+
+uint64_t now_us() {
+    return chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Smallest power of two >= n
+unsigned round_up_pow2(unsigned n) {
+    unsigned p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// Intrusive list node for one retransmission deadline. Owned by the caller,
+// so arming and cancelling never allocate.
+struct TimerNode {
+    TimerNode* prev = nullptr;
+    TimerNode* next = nullptr;
+    uint64_t expires = 0;  // Absolute tick
+    uint32_t seq_num = 0;
+
+    bool armed() const { return prev != nullptr; }
+};
+
+// Hierarchical timing wheel: 256 slots of TIMER_TICK_US at level 0, then 64
+// slots per level for coarser deadlines. Arm and cancel are O(1); expiry is
+// O(1) per timer plus occasional cascading of a coarse slot into finer ones.
+class TimerWheel {
+    static const int LEVELS = 4;
+    static const int LEVEL0_BITS = 8;
+    static const int LEVEL_BITS = 6;
+    static const uint64_t LEVEL0_SIZE = 1 << LEVEL0_BITS;
+    static const uint64_t LEVEL_SIZE = 1 << LEVEL_BITS;
+
+    vector<TimerNode> slots[LEVELS];  // Sentinel heads of circular lists
+    uint64_t tick_us;
+    uint64_t current_tick;
+    size_t active = 0;
+
+    static void push(TimerNode& head, TimerNode& node) {
+        node.next = &head;
+        node.prev = head.prev;
+        head.prev->next = &node;
+        head.prev = &node;
+    }
+
+    static void unlink(TimerNode& node) {
+        node.prev->next = node.next;
+        node.next->prev = node.prev;
+        node.prev = node.next = nullptr;
+    }
+
+    void place(TimerNode& node) {
+        if (node.expires <= current_tick) node.expires = current_tick + 1;
+        uint64_t delta = node.expires - current_tick;
+        if (delta < LEVEL0_SIZE) {
+            push(slots[0][node.expires & (LEVEL0_SIZE - 1)], node);
+            return;
+        }
+        int level = 1, shift = LEVEL0_BITS;
+        while (level < LEVELS - 1 && delta >= (uint64_t(1) << (shift + LEVEL_BITS))) {
+            level++;
+            shift += LEVEL_BITS;
+        }
+        uint64_t limit = uint64_t(1) << (shift + LEVEL_BITS);
+        if (delta >= limit) node.expires = current_tick + limit - 1;  // Clamp to the wheel's span
+        push(slots[level][(node.expires >> shift) & (LEVEL_SIZE - 1)], node);
+    }
+
+    // Moves every timer in a coarse slot down to the level that now fits it
+    void cascade(int level, size_t index) {
+        TimerNode& head = slots[level][index];
+        while (head.next != &head) {
+            TimerNode& node = *head.next;
+            unlink(node);
+            place(node);
+        }
+    }
+
+public:
+    TimerWheel(uint64_t tick, uint64_t start_us) : tick_us(tick), current_tick(start_us / tick) {
+        for (int level = 0; level < LEVELS; level++) {
+            slots[level] = vector<TimerNode>(level == 0 ? LEVEL0_SIZE : LEVEL_SIZE);
+            for (TimerNode& head : slots[level]) {
+                head.prev = head.next = &head;
+            }
+        }
+    }
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    void arm(TimerNode& node, uint64_t deadline_us) {
+        if (node.armed()) unlink(node);
+        else active++;
+        node.expires = (deadline_us + tick_us - 1) / tick_us;
+        place(node);
+    }
+
+    void cancel(TimerNode& node) {
+        if (!node.armed()) return;
+        unlink(node);
+        active--;
+    }
+
+    bool empty() const { return active == 0; }
+
+    // Earliest time worth waking up for: the next occupied level-0 slot, or
+    // the next cascade boundary if level 0 is empty.
+    uint64_t next_wakeup_us() const {
+        for (uint64_t t = current_tick + 1; t <= current_tick + LEVEL0_SIZE; t++) {
+            const TimerNode& head = slots[0][t & (LEVEL0_SIZE - 1)];
+            if (head.next != &head) return t * tick_us;
+            if ((t & (LEVEL0_SIZE - 1)) == 0) return t * tick_us;
+        }
+        return (current_tick + LEVEL0_SIZE) * tick_us;
+    }
+
+    // Fires every timer due at or before now. on_expire may re-arm the node.
+    template <typename Callback>
+    void advance(uint64_t now, Callback on_expire) {
+        uint64_t target = now / tick_us;
+        if (active == 0) {
+            current_tick = max(current_tick, target);
+            return;
+        }
+        while (current_tick < target) {
+            current_tick++;
+            size_t index = current_tick & (LEVEL0_SIZE - 1);
+            int shift = LEVEL0_BITS;
+            for (int level = 1; level < LEVELS && index == 0; level++, shift += LEVEL_BITS) {
+                index = (current_tick >> shift) & (LEVEL_SIZE - 1);
+                cascade(level, index);
+            }
+            TimerNode& head = slots[0][current_tick & (LEVEL0_SIZE - 1)];
+            while (head.next != &head) {
+                TimerNode& node = *head.next;
+                unlink(node);
+                active--;
+                on_expire(node);
+            }
+        }
+    }
+};
+
+// Earlier of two wakeup times, where 0 means none
+uint64_t earliest_wakeup(uint64_t a, uint64_t b) {
+    return a == 0 ? b : b == 0 ? a : min(a, b);
+}
+
+// Points the timerfd at wake_us, or disarms it for 0
+void arm_timerfd(int tfd, uint64_t wake_us) {
+    itimerspec spec{};
+    if (wake_us != 0) {
+        spec.it_value.tv_sec = wake_us / 1000000;
+        spec.it_value.tv_nsec = (wake_us % 1000000) * 1000;
+    }
+    if (timerfd_settime(tfd, TFD_TIMER_ABSTIME, &spec, nullptr) < 0) {
+        handle_error("timerfd_settime failed");
+    }
+}
+
+// RFC 6298 retransmission timeout estimator. Backoff is kept as a separate
+// shift so it can be dropped as soon as the path makes progress again, even
+// when the ACK that shows it brings no fresh sample to recompute from.
+class RttEstimator {
+    uint64_t srtt = 0;
+    uint64_t rttvar = 0;
+    uint64_t rto = INITIAL_RTO_US;
+    int backoff_shift = 0;
+    bool has_sample = false;
+    uint64_t min_rtt = 0;        // Lowest recent sample, the path's propagation delay
+    uint64_t min_rtt_stamp = 0;  // When it was taken
+public:
+    void add_sample(uint64_t rtt_us) {
+        uint64_t now = now_us();
+        if (min_rtt == 0 || rtt_us <= min_rtt || now - min_rtt_stamp > MIN_RTT_EXPIRY_US) {
+            min_rtt = rtt_us;
+            min_rtt_stamp = now;
+        }
+        if (!has_sample) {
+            srtt = rtt_us;
+            rttvar = rtt_us / 2;
+            has_sample = true;
+        } else {
+            uint64_t diff = srtt > rtt_us ? srtt - rtt_us : rtt_us - srtt;
+            rttvar = (3 * rttvar + diff) / 4;
+            srtt = (7 * srtt + rtt_us) / 8;
+        }
+        // Room for the receiver's delayed ACK on top of the variance, which
+        // on a quiet path is smaller than the delay itself (RFC 9002 6.2.1)
+        rto = srtt + std::max(TIMER_TICK_US, 4 * rttvar) + PEER_ACK_DELAY_US;
+        rto = std::min(std::max(rto, MIN_RTO_US), MAX_RTO_US);
+        backoff_shift = 0;
+    }
+
+    // Called once per timeout of the oldest outstanding packet
+    void backoff() {
+        if ((rto << backoff_shift) < MAX_RTO_US) backoff_shift++;
+    }
+
+    // New data was cumulatively acknowledged
+    void on_progress() { backoff_shift = 0; }
+
+    uint64_t rto_us() const { return std::min(rto << backoff_shift, MAX_RTO_US); }
+    uint64_t srtt_us() const { return srtt; }
+    uint64_t min_rtt_us() const { return min_rtt; }
+};
+
+// Congestion window in packets, kept next to the flow-control window; the
+// sender keeps at most min(cwnd, window) packets in flight. Subclasses
+// decide how cwnd grows on ACKs and where it lands after a loss. Losses of
+// packets sent before the previous reduction belong to the same congestion
+// event and are ignored, and cwnd does not grow again until everything in
+// flight at the time of the loss has been acked.
+class CongestionController {
+    bool recovering = false;   // Within a congestion event
+    bool growing = true;       // False during loss recovery
+    uint32_t recovery_end = 0; // next_seq_num when the event started
+protected:
+    double cwnd = INITIAL_CWND;
+    double ssthresh;
+    double max_cwnd;
+
+    // newly_acked packets were acked outside loss recovery
+    virtual void increase(int newly_acked, uint64_t now, uint64_t srtt_us) = 0;
+    // Sets ssthresh and cwnd for a new congestion event
+    virtual void reduce() = 0;
+
+    // Slow start up to ssthresh; returns the acks left over for congestion avoidance
+    int slow_start(int newly_acked) {
+        int used = 0;
+        while (used < newly_acked && cwnd < ssthresh) {
+            cwnd++;
+            used++;
+        }
+        return newly_acked - used;
+    }
+public:
+    // max_window is the flow-control window; cwnd beyond it could never be used
+    explicit CongestionController(int max_window) : ssthresh(max_window), max_cwnd(max_window) {
+        cwnd = min(cwnd, max_cwnd);
+    }
+    virtual ~CongestionController() {}
+
+    // newly_acked packets were acked and the window base is now base
+    void on_ack(int newly_acked, uint32_t base, uint64_t now, uint64_t srtt_us) {
+        if (recovering && !seq_before(base, recovery_end)) {
+            recovering = false;
+            growing = true;
+        }
+        if (growing && newly_acked > 0) {
+            increase(newly_acked, now, srtt_us);
+            cwnd = min(cwnd, max_cwnd);
+        }
+    }
+
+    // seq was found lost while later packets still get through. Returns
+    // whether that started a new congestion event.
+    bool on_loss(uint32_t seq, uint32_t next_seq_num) {
+        if (recovering && seq_before(seq, recovery_end)) return false;
+        recovering = true;
+        growing = false;
+        recovery_end = next_seq_num;
+        reduce();
+        return true;
+    }
+
+    // The oldest outstanding packet timed out: the path may have gone quiet
+    // altogether, so restart from one packet in slow start (RFC 5681 3.1)
+    bool on_timeout(uint32_t seq, uint32_t next_seq_num) {
+        bool new_event = on_loss(seq, next_seq_num);
+        cwnd = 1;
+        growing = true;
+        return new_event;
+    }
+
+    double window() const { return cwnd; }
+    bool in_slow_start() const { return cwnd < ssthresh; }
+};
+
+// Additive increase of one packet per RTT, halving on loss
+class NewReno : public CongestionController {
+    void increase(int newly_acked, uint64_t, uint64_t) override {
+        newly_acked = slow_start(newly_acked);
+        cwnd += newly_acked / cwnd;
+    }
+
+    void reduce() override {
+        ssthresh = max(cwnd / 2, MIN_CWND);
+        cwnd = ssthresh;
+    }
+public:
+    using CongestionController::CongestionController;
+};
+
+// cwnd follows a cubic function of the time since the last reduction,
+// centred on the window where that loss happened, so it climbs back there
+// quickly, probes carefully around it and speeds up once past. It never
+// falls behind what Reno would reach on the same path.
+class Cubic : public CongestionController {
+    double w_max = 0;           // cwnd at the last reduction
+    double k = 0;               // Seconds the curve takes to get back to w_max
+    double origin = 0;
+    double w_est = 0;           // Reno-equivalent window
+    uint64_t epoch_start_us = 0;
+
+    void increase(int newly_acked, uint64_t now, uint64_t srtt_us) override {
+        newly_acked = slow_start(newly_acked);
+        if (newly_acked == 0) return;
+        if (epoch_start_us == 0) {
+            epoch_start_us = now;
+            if (cwnd < w_max) {
+                k = cbrt((w_max - cwnd) / CUBIC_C);
+                origin = w_max;
+            } else {
+                k = 0;
+                origin = cwnd;
+            }
+            w_est = cwnd;
+        }
+        // Aim one RTT ahead, as the window being opened now is used then
+        double t = (now - epoch_start_us + srtt_us) / 1e6;
+        double target = origin + CUBIC_C * (t - k) * (t - k) * (t - k);
+        if (target > cwnd) {
+            cwnd += min(target - cwnd, cwnd / 2) / cwnd * newly_acked;
+        } else {
+            cwnd += 0.01 * newly_acked / cwnd;
+        }
+        w_est += 3 * (1 - CUBIC_BETA) / (1 + CUBIC_BETA) * newly_acked / cwnd;
+        cwnd = max(cwnd, w_est);
+    }
+
+    void reduce() override {
+        epoch_start_us = 0;
+        // Fast convergence: a flow losing ground releases bandwidth sooner
+        w_max = cwnd < w_max ? cwnd * (1 + CUBIC_BETA) / 2 : cwnd;
+        ssthresh = max(cwnd * CUBIC_BETA, MIN_CWND);
+        cwnd = ssthresh;
+    }
+public:
+    using CongestionController::CongestionController;
+};
+
+unique_ptr<CongestionController> make_congestion_controller(CongestionAlgorithm algorithm, int max_window) {
+    switch (algorithm) {
+    case CC_NEWRENO: return unique_ptr<CongestionController>(new NewReno(max_window));
+    case CC_CUBIC: return unique_ptr<CongestionController>(new Cubic(max_window));
+    default: return nullptr;
+    }
+}
+
+// Window sized to the path rather than guessed at the prompt. Every round
+// of at least one min RTT the packets acked during it give a delivery-rate
+// sample; the bottleneck rate is the best of the last DELIVERY_RATE_ROUNDS,
+// so a round that was short of data or stalled on a timeout does not drag it
+// down. The window heads for AUTO_WINDOW_GAIN times rate x min RTT. While
+// the window is what limits delivery a round measures about window / RTT,
+// so it roughly doubles per round, like slow start, until the rate stops
+// following; from there it holds enough to keep the pipe full through
+// delayed and batched ACKs. It grows at once but gives back only a quarter
+// of the excess per round, as one slow round says little. The caller bounds
+// it by the receiver's advertised window.
+class WindowTuner {
+    const int max_window;
+    double window;
+    double rate_samples[DELIVERY_RATE_ROUNDS] = {};  // Packets per second
+    int rounds = 0;
+    uint64_t round_start_us = 0;
+    int round_acked = 0;
+public:
+    explicit WindowTuner(int max) : max_window(max), window(min(AUTO_WINDOW_INITIAL, max)) {}
+
+    // newly_acked packets were acked at now. Returns whether a round ended,
+    // which is when the window moves.
+    bool on_ack(int newly_acked, uint64_t now, uint64_t min_rtt_us) {
+        if (round_start_us == 0) round_start_us = now;
+        round_acked += newly_acked;
+        uint64_t elapsed = now - round_start_us;
+        if (min_rtt_us == 0 || elapsed < max(min_rtt_us, TIMER_TICK_US)) return false;
+        rate_samples[rounds++ % DELIVERY_RATE_ROUNDS] = round_acked * 1e6 / elapsed;
+        round_start_us = now;
+        round_acked = 0;
+
+        double target = AUTO_WINDOW_GAIN * bandwidth() * min_rtt_us / 1e6;
+        target = min(max(target, static_cast<double>(AUTO_WINDOW_MIN)), static_cast<double>(max_window));
+        window = target >= window ? target : window - (window - target) / 4;
+        return true;
+    }
+
+    int current() const { return max(static_cast<int>(window), 1); }
+    double bandwidth() const { return *max_element(rate_samples, rate_samples + DELIVERY_RATE_ROUNDS); }
+};
+
+// Everything the sender keeps about one packet in flight, in one cache
+// line. The serialized packet lives in the matching PacketPool buffer.
+struct alignas(64) SendSlot {
+    TimerNode timer;                // Retransmission deadline, timer.seq_num is the packet
+    uint64_t sent_us = 0;           // Latest transmission, what an echoing ACK is timed against
+    const char* payload = nullptr;  // In the pool buffer, or in the file mapping
+    uint32_t payload_crc = 0;       // CRC state after the payload, for patch_attempt()
+    uint16_t payload_len = 0;
+    uint16_t retries = 0;
+    bool acked = false;
+};
+
+// Arena of fixed-size packet buffers carved from one anonymous mapping, so
+// packets never go through malloc. Each buffer is PACKET_SIZE bytes, which
+// keeps every one cache-line aligned. With huge pages the mapping comes from
+// MAP_HUGETLB, falling back to ordinary pages with a transparent huge page
+// hint when none are reserved.
+class PacketPool {
+    char* base = nullptr;
+    size_t bytes = 0;
+public:
+    PacketPool(size_t count, bool huge_pages) {
+        bytes = count * PACKET_SIZE;
+        void* map = MAP_FAILED;
+        if (huge_pages) {
+            bytes = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+            map = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+            if (map == MAP_FAILED) {
+                cerr << "[Sender] No huge pages available, using regular pages\n";
+            }
+        }
+        if (map == MAP_FAILED) {
+            map = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (map == MAP_FAILED) handle_error("Packet pool mmap failed");
+            if (huge_pages) madvise(map, bytes, MADV_HUGEPAGE);
+        }
+        base = static_cast<char*>(map);
+    }
+    PacketPool(const PacketPool&) = delete;
+    PacketPool& operator=(const PacketPool&) = delete;
+    ~PacketPool() { munmap(base, bytes); }
+
+    char* buffer(size_t index) { return base + index * PACKET_SIZE; }
+};
+
+// Send slots and their pool buffers, indexed by seq modulo a power-of-two
+// capacity of at least the window size. The window never spans more than
+// capacity sequence numbers, so a slot and its buffer are recycled as soon
+// as the packet before it has been acked, and sender memory stays
+// O(window) however long the transfer runs.
+class SendRing {
+    vector<SendSlot> slots;
+    uint32_t mask;
+    PacketPool pool;
+public:
+    SendRing(int window_size, bool huge_pages)
+        : slots(round_up_pow2(window_size)), mask(slots.size() - 1),
+          pool(slots.size(), huge_pages) {}
+
+    SendSlot& operator[](uint32_t seq_num) { return slots[seq_num & mask]; }
+    char* buffer(uint32_t seq_num) { return pool.buffer(seq_num & mask); }
+};
+
+// Read-only mapping of the file being sent. Packet seq carries the
+// MAX_PAYLOAD_SIZE-byte slice starting at seq * MAX_PAYLOAD_SIZE, read
+// straight from the page cache for first sends and retransmissions alike.
+class MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+    bool opened = false;
+public:
+    MappedFile() {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() {
+        if (data) munmap(const_cast<char*>(data), size);
+    }
+
+    void open(const string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) handle_error("Cannot open " + path);
+        struct stat st;
+        if (fstat(fd, &st) < 0) handle_error("fstat failed");
+        size = st.st_size;
+        if (size > 0) {
+            void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map == MAP_FAILED) handle_error("mmap of " + path + " failed");
+            madvise(map, size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(map);
+        }
+        close(fd);
+        opened = true;
+    }
+
+    bool is_open() const { return opened; }
+    size_t bytes() const { return size; }
+
+    // An empty file still takes one (empty) packet
+    int packet_count() const {
+        return max<size_t>(1, (size + MAX_PAYLOAD_SIZE - 1) / MAX_PAYLOAD_SIZE);
+    }
+
+    const char* slice(uint32_t seq_num, size_t& len) const {
+        size_t offset = size_t(seq_num) * MAX_PAYLOAD_SIZE;
+        if (offset >= size) {
+            len = 0;
+            return data;
+        }
+        len = min(MAX_PAYLOAD_SIZE, size - offset);
+        return data + offset;
+    }
+};
+
+MappedFile input_file;
+
+int create_udp_socket() {
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        handle_error("Socket creation failed");
+    }
+    
+    // Set socket options
+    int reuse = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0) {
+        handle_error("setsockopt(SO_REUSEADDR) failed");
+    }
+    
+    // Add send buffer optimization
+    int send_buff_size = options.gso ? GSO_SEND_BUFFER_SIZE : SEND_BUFFER_SIZE;
+    if (setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &send_buff_size, sizeof(send_buff_size)) < 0) {
+        handle_error("setsockopt(SO_SNDBUF) failed");
+    }
+    
+    // Enable keep-alive
+    int keepalive = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &keepalive, sizeof(keepalive)) < 0) {
+        handle_error("setsockopt(SO_KEEPALIVE) failed");
+    }
+    
+    return sock;
+}
+
+clockid_t txtime_clock = CLOCK_MONOTONIC;  // etf wants CLOCK_TAI
+
+// Kinds of the qdiscs on the interface packets to dest leave through. The
+// kernel picks the source address for dest, the interface holding that
+// address is the one, and its qdiscs come from an rtnetlink dump.
+vector<string> egress_qdiscs(const sockaddr_in& dest) {
+    vector<string> kinds;
+    int probe = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in local{};
+    socklen_t local_len = sizeof(local);
+    bool routed = probe >= 0 && connect(probe, reinterpret_cast<const sockaddr*>(&dest), sizeof(dest)) == 0 &&
+                  getsockname(probe, reinterpret_cast<sockaddr*>(&local), &local_len) == 0;
+    if (probe >= 0) close(probe);
+    if (!routed) return kinds;
+
+    unsigned ifindex = 0;
+    ifaddrs* addrs;
+    if (getifaddrs(&addrs) < 0) return kinds;
+    for (ifaddrs* ifa = addrs; ifa; ifa = ifa->ifa_next) {
+        if (ifa->ifa_addr && ifa->ifa_addr->sa_family == AF_INET &&
+            reinterpret_cast<sockaddr_in*>(ifa->ifa_addr)->sin_addr.s_addr == local.sin_addr.s_addr) {
+            ifindex = if_nametoindex(ifa->ifa_name);
+            break;
+        }
+    }
+    freeifaddrs(addrs);
+    if (ifindex == 0) return kinds;
+
+    int nl = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (nl < 0) return kinds;
+    struct {
+        nlmsghdr nh;
+        tcmsg tc;
+    } request{};
+    request.nh.nlmsg_len = sizeof(request);
+    request.nh.nlmsg_type = RTM_GETQDISC;
+    request.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.tc.tcm_family = AF_UNSPEC;
+    if (send(nl, &request, sizeof(request), 0) < 0) {
+        close(nl);
+        return kinds;
+    }
+    vector<char> buf(32768);
+    bool done = false;
+    while (!done) {
+        ssize_t len = recv(nl, buf.data(), buf.size(), 0);
+        if (len <= 0) break;
+        for (nlmsghdr* nh = reinterpret_cast<nlmsghdr*>(buf.data()); NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+            if (nh->nlmsg_type == NLMSG_DONE || nh->nlmsg_type == NLMSG_ERROR) {
+                done = true;
+                break;
+            }
+            tcmsg* tc = static_cast<tcmsg*>(NLMSG_DATA(nh));
+            if (nh->nlmsg_type != RTM_NEWQDISC || tc->tcm_ifindex != static_cast<int>(ifindex)) continue;
+            int attr_len = nh->nlmsg_len - NLMSG_LENGTH(sizeof(*tc));
+            for (rtattr* attr = reinterpret_cast<rtattr*>(reinterpret_cast<char*>(tc) + NLMSG_ALIGN(sizeof(*tc)));
+                 RTA_OK(attr, attr_len); attr = RTA_NEXT(attr, attr_len)) {
+                if (attr->rta_type == TCA_KIND) kinds.push_back(static_cast<const char*>(RTA_DATA(attr)));
+            }
+        }
+    }
+    close(nl);
+    return kinds;
+}
+
+// Best pacing mechanism towards dest: departure times when fq or etf will
+// keep them, the user-space pacer otherwise. SO_MAX_PACING_RATE is the
+// fallback per socket when SO_TXTIME is refused (see Pacer).
+PacingMode detect_pacing(const sockaddr_in& dest) {
+    for (const string& kind : egress_qdiscs(dest)) {
+        if (kind == "etf") {
+            txtime_clock = CLOCK_TAI;
+            return PACING_TXTIME;
+        }
+        if (kind == "fq") return PACING_TXTIME;
+    }
+    return PACING_USER;
+}
+
+// Spreads one socket's packets out at a target rate. Each packet departs no
+// earlier than its predecessor plus that one's transmission time at the
+// rate; idle time builds no credit, so there are no catch-up bursts. The
+// departure times go to the kernel with each packet (PACING_TXTIME), or the
+// send loop waits for them (PACING_USER); with PACING_RATE the kernel gets
+// only the rate.
+class Pacer {
+    PacingMode mode;
+    int sock;
+    double ns_per_byte = 0;       // 0 while unpaced
+    uint64_t next_ns = 0;         // Earliest departure of the next packet, now_us() clock
+    int64_t clock_offset_ns = 0;  // txtime_clock minus the now_us() clock
+    uint64_t socket_rate = 0;     // Last SO_MAX_PACING_RATE, bytes/s
+
+    bool set_socket_rate(uint64_t bytes_per_sec) {
+        unsigned long long rate = bytes_per_sec;
+        if (setsockopt(sock, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate)) < 0) return false;
+        socket_rate = bytes_per_sec;
+        return true;
+    }
+public:
+    Pacer(PacingMode wanted, int socket_fd) : mode(wanted), sock(socket_fd) {
+        if (mode == PACING_TXTIME) {
+            sock_txtime config{};
+            config.clockid = txtime_clock;
+            if (setsockopt(sock, SOL_SOCKET, SO_TXTIME, &config, sizeof(config)) < 0) {
+                mode = PACING_RATE;
+            } else if (txtime_clock != CLOCK_MONOTONIC) {
+                timespec tai, mono;
+                clock_gettime(txtime_clock, &tai);
+                clock_gettime(CLOCK_MONOTONIC, &mono);
+                clock_offset_ns = (int64_t(tai.tv_sec) - mono.tv_sec) * 1000000000 + (tai.tv_nsec - mono.tv_nsec);
+            }
+        }
+        if (mode == PACING_RATE && !set_socket_rate(~0ULL)) mode = PACING_USER;
+    }
+
+    PacingMode current_mode() const { return mode; }
+    double rate_mbps() const { return ns_per_byte > 0 ? 8e3 / ns_per_byte : 0; }
+
+    void set_rate(double bytes_per_sec) {
+        if (mode == PACING_OFF || bytes_per_sec <= 0) return;
+        ns_per_byte = 1e9 / bytes_per_sec;
+        // One setsockopt per ACK would be wasteful; only follow real changes
+        uint64_t rate = static_cast<uint64_t>(bytes_per_sec);
+        if (mode == PACING_RATE && (rate > socket_rate + socket_rate / 8 || rate < socket_rate - socket_rate / 8)) {
+            set_socket_rate(rate);
+        }
+    }
+
+    // With the user-space pacer, whether the next packet may go out now
+    bool ready(uint64_t now) const {
+        return mode != PACING_USER || next_ns <= (now + PACING_SLACK_US) * 1000;
+    }
+
+    // When the user-space pacer lets the next packet go
+    uint64_t next_departure_us() const { return (next_ns + 999) / 1000; }
+
+    // Charges a len-byte packet leaving at the earliest now. Returns its
+    // SO_TXTIME departure on txtime_clock, or 0 when it goes right away.
+    uint64_t on_send(size_t len, uint64_t now) {
+        if (ns_per_byte == 0) return 0;
+        uint64_t depart_ns = max(next_ns, now * 1000);
+        next_ns = depart_ns + static_cast<uint64_t>(len * ns_per_byte);
+        return mode == PACING_TXTIME ? depart_ns + clock_offset_ns : 0;
+    }
+};
+
+bool simulate_packet_loss() {
+    static thread_local random_device rd;
+    static thread_local mt19937 gen(rd());
+    static thread_local uniform_real_distribution<> dis(0, 1);
+    return dis(gen) < 0.1; // 10% packet loss rate
+}
+
+// CRC32C (Castagnoli) integrity check. Every implementation below produces the
+// same value; the fastest one the CPU supports is picked at startup and its id
+// is recorded in PacketHeader::checksum_type.
+enum ChecksumType : uint8_t {
+    CHECKSUM_CRC32C_SW = 1,      // Slicing-by-8 tables
+    CHECKSUM_CRC32C_SSE42 = 2,   // SSE4.2 crc32 instruction
+    CHECKSUM_CRC32C_PCLMUL = 3   // Three crc32 lanes merged with PCLMULQDQ
+};
+
+const uint32_t CRC32C_POLY = 0x82F63B78;  // Reflected Castagnoli polynomial
+const size_t CRC_LANE_BYTES = 256;        // Per-lane stride of the PCLMUL variant
+
+typedef uint32_t (*Crc32cFn)(uint32_t crc, const unsigned char* data, size_t len);
+
+struct ChecksumEngine {
+    ChecksumType type;
+    const char* name;
+    Crc32cFn update;  // Raw register update, no pre/post inversion
+};
+
+uint32_t crc32c_table[8][256];
+uint64_t crc_lane_shift1, crc_lane_shift2;  // x^(8n-33) mod P for n = 1 and 2 lanes
+
+inline uint32_t load_le32(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t load_le64(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// x^n mod P in the reflected representation (bit 31 holds x^0)
+uint32_t crc32c_xpow(size_t n) {
+    uint32_t v = 0x80000000u;
+    while (n--) {
+        v = (v & 1) ? (v >> 1) ^ CRC32C_POLY : v >> 1;
+    }
+    return v;
+}
+
+uint32_t crc32c_sw(uint32_t crc, const unsigned char* p, size_t len) {
+    // Assumes a little-endian host
+    while (len >= 8) {
+        uint32_t a = crc ^ load_le32(p);
+        uint32_t b = load_le32(p + 4);
+        crc = crc32c_table[7][a & 0xff] ^ crc32c_table[6][(a >> 8) & 0xff] ^
+              crc32c_table[5][(a >> 16) & 0xff] ^ crc32c_table[4][a >> 24] ^
+              crc32c_table[3][b & 0xff] ^ crc32c_table[2][(b >> 8) & 0xff] ^
+              crc32c_table[1][(b >> 16) & 0xff] ^ crc32c_table[0][b >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p++) & 0xff];
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+uint32_t crc32c_sse42(uint32_t crc, const unsigned char* p, size_t len) {
+    uint64_t c = crc;
+    while (len >= 8) {
+        c = _mm_crc32_u64(c, load_le64(p));
+        p += 8;
+        len -= 8;
+    }
+    crc = static_cast<uint32_t>(c);
+    while (len--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+
+// Advances crc over (8n) zero bytes, given k = x^(8n-33) mod P
+__attribute__((target("sse4.2,pclmul")))
+inline uint32_t crc32c_shift(uint32_t crc, uint64_t k) {
+    __m128i prod = _mm_clmulepi64_si128(_mm_cvtsi32_si128(static_cast<int>(crc)),
+                                        _mm_cvtsi64_si128(static_cast<long long>(k)), 0x00);
+    return static_cast<uint32_t>(_mm_crc32_u64(0, static_cast<uint64_t>(_mm_cvtsi128_si64(prod))));
+}
+
+// Hides the 3-cycle crc32 latency by running three independent lanes and
+// folding the two leading lanes forward with a carry-less multiply.
+__attribute__((target("sse4.2,pclmul")))
+uint32_t crc32c_pclmul(uint32_t crc, const unsigned char* p, size_t len) {
+    while (len >= 3 * CRC_LANE_BYTES) {
+        uint64_t c0 = crc, c1 = 0, c2 = 0;
+        for (size_t i = 0; i < CRC_LANE_BYTES; i += 8) {
+            c0 = _mm_crc32_u64(c0, load_le64(p + i));
+            c1 = _mm_crc32_u64(c1, load_le64(p + CRC_LANE_BYTES + i));
+            c2 = _mm_crc32_u64(c2, load_le64(p + 2 * CRC_LANE_BYTES + i));
+        }
+        crc = crc32c_shift(static_cast<uint32_t>(c0), crc_lane_shift2) ^
+              crc32c_shift(static_cast<uint32_t>(c1), crc_lane_shift1) ^
+              static_cast<uint32_t>(c2);
+        p += 3 * CRC_LANE_BYTES;
+        len -= 3 * CRC_LANE_BYTES;
+    }
+    return crc32c_sse42(crc, p, len);
+}
+#endif
+
+ChecksumEngine checksum_engine = {CHECKSUM_CRC32C_SW, "crc32c-slice8", crc32c_sw};
+
+vector<ChecksumEngine> available_checksum_engines() {
+    vector<ChecksumEngine> engines = {{CHECKSUM_CRC32C_SW, "crc32c-slice8", crc32c_sw}};
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("sse4.2")) {
+        engines.push_back({CHECKSUM_CRC32C_SSE42, "crc32c-sse4.2", crc32c_sse42});
+        if (__builtin_cpu_supports("pclmul")) {
+            engines.push_back({CHECKSUM_CRC32C_PCLMUL, "crc32c-pclmul", crc32c_pclmul});
+        }
+    }
+#endif
+    return engines;
+}
+
+// Builds the software tables and picks the fastest engine via CPUID
+void init_checksum() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+        }
+        crc32c_table[0][i] = c;
+    }
+    for (int t = 1; t < 8; t++) {
+        for (int i = 0; i < 256; i++) {
+            uint32_t prev = crc32c_table[t - 1][i];
+            crc32c_table[t][i] = (prev >> 8) ^ crc32c_table[0][prev & 0xff];
+        }
+    }
+    crc_lane_shift1 = crc32c_xpow(8 * CRC_LANE_BYTES - 33);
+    crc_lane_shift2 = crc32c_xpow(16 * CRC_LANE_BYTES - 33);
+    checksum_engine = available_checksum_engines().back();
+}
+
+bool is_crc32c_type(uint8_t type) {
+    return type >= CHECKSUM_CRC32C_SW && type <= CHECKSUM_CRC32C_PCLMUL;
+}
+
+// Covers the payload followed by the header up to (not including) the
+// checksum field, so header-only changes can reuse the payload CRC.
+uint32_t payload_crc(const char* payload, size_t len) {
+    return checksum_engine.update(0xFFFFFFFFu, reinterpret_cast<const unsigned char*>(payload), len);
+}
+
+uint32_t finish_checksum(uint32_t payload_crc, const PacketHeader& hdr) {
+    return ~checksum_engine.update(payload_crc, reinterpret_cast<const unsigned char*>(&hdr),
+                                   offsetof(PacketHeader, checksum));
+}
+
+uint32_t packet_checksum(const PacketHeader& hdr, const char* payload, size_t len) {
+    return finish_checksum(payload_crc(payload, len), hdr);
+}
+
+// Writes the HEADER_SIZE-byte header for payload into out. The payload
+// itself can then be sent from wherever it lives. Returns the payload's CRC
+// state for patch_attempt().
+uint32_t encode_header(char* out, uint32_t conn_id, uint32_t seq_num, const char* payload, size_t len,
+                       uint8_t flags = FLAG_DATA) {
+    PacketHeader hdr;
+    hdr.magic = htons(PACKET_MAGIC);
+    hdr.version = PROTOCOL_VERSION;
+    hdr.flags = flags;
+    hdr.conn_id = htonl(conn_id);
+    hdr.seq_num = htonl(seq_num);
+    hdr.payload_len = htons(static_cast<uint16_t>(len));
+    hdr.checksum_type = checksum_engine.type;
+    hdr.attempt = 0;
+    uint32_t crc = payload_crc(payload, len);
+    hdr.checksum = htonl(finish_checksum(crc, hdr));
+    memcpy(out, &hdr, HEADER_SIZE);
+    return crc;
+}
+
+// Updates the attempt field of an encoded header in place. Only the header
+// is re-checksummed; the payload's CRC state comes from encode_header().
+void patch_attempt(char* header, uint32_t payload_crc, int attempt) {
+    PacketHeader hdr;
+    memcpy(&hdr, header, HEADER_SIZE);
+    hdr.attempt = static_cast<uint8_t>(min(attempt, 255));
+    hdr.checksum = htonl(finish_checksum(payload_crc, hdr));
+    memcpy(header, &hdr, HEADER_SIZE);
+}
+
+// Serializes header + payload into out (at least HEADER_SIZE + len bytes).
+// Returns the datagram length.
+size_t encode_packet(char* out, uint32_t conn_id, uint32_t seq_num, const char* payload, size_t len,
+                     uint8_t flags = FLAG_DATA) {
+    encode_header(out, conn_id, seq_num, payload, len, flags);
+    memcpy(out + HEADER_SIZE, payload, len);
+    return HEADER_SIZE + len;
+}
+
+// Forward error correction (--fec on the sender, Selective Repeat only). The
+// data packets of a stripe are grouped into blocks, and each block is
+// followed by repair packets, every one a different linear combination of
+// the block's coding symbols over GF(2^8). Repair j of a block with symbols
+// d_i is the sum of fec_matrix[j][i] * d_i. The matrix is a Cauchy matrix
+// with every column scaled so that row 0 is all ones: repair 0 is plain XOR
+// parity, yet any m rows still solve for any m missing symbols (a
+// systematic Reed-Solomon code), so a block survives as many losses as it
+// has repair packets.
+const unsigned GF_POLY = 0x11D;  // x^8 + x^4 + x^3 + x^2 + 1
+
+uint8_t gf_exp[512];  // Doubled so a sum of two logs needs no reduction
+uint8_t gf_log[256];
+uint8_t gf_nibble[256][2][16];  // c times each low nibble and each high nibble, for PSHUFB
+uint8_t fec_matrix[FEC_MAX_REPAIR][FEC_MAX_DATA];
+
+inline uint8_t gf_mul(uint8_t a, uint8_t b) {
+    return a && b ? gf_exp[gf_log[a] + gf_log[b]] : 0;
+}
+
+inline uint8_t gf_inv(uint8_t a) {
+    return gf_exp[255 - gf_log[a]];
+}
+
+// dst ^= c * src, bytewise
+typedef void (*GfMulAddFn)(uint8_t* dst, const uint8_t* src, size_t len, uint8_t c);
+
+void gf_mul_add_sw(uint8_t* dst, const uint8_t* src, size_t len, uint8_t c) {
+    const uint8_t* lo = gf_nibble[c][0];
+    const uint8_t* hi = gf_nibble[c][1];
+    for (size_t i = 0; i < len; i++) {
+        dst[i] ^= lo[src[i] & 0x0F] ^ hi[src[i] >> 4];
+    }
+}
+
+#if defined(__x86_64__)
+// Sixteen products per instruction: PSHUFB looks up both nibbles of every
+// byte in c's 16-entry tables
+__attribute__((target("ssse3")))
+void gf_mul_add_ssse3(uint8_t* dst, const uint8_t* src, size_t len, uint8_t c) {
+    const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(gf_nibble[c][0]));
+    const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(gf_nibble[c][1]));
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i p = _mm_xor_si128(_mm_shuffle_epi8(lo, _mm_and_si128(s, mask)),
+                                  _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi64(s, 4), mask)));
+        __m128i* d = reinterpret_cast<__m128i*>(dst + i);
+        _mm_storeu_si128(d, _mm_xor_si128(_mm_loadu_si128(d), p));
+    }
+    gf_mul_add_sw(dst + i, src + i, len - i, c);
+}
+
+// The same on 32 bytes, the tables repeated in both lanes
+__attribute__((target("avx2")))
+void gf_mul_add_avx2(uint8_t* dst, const uint8_t* src, size_t len, uint8_t c) {
+    const __m256i lo = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(gf_nibble[c][0])));
+    const __m256i hi = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(gf_nibble[c][1])));
+    const __m256i mask = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i p = _mm256_xor_si256(_mm256_shuffle_epi8(lo, _mm256_and_si256(s, mask)),
+                                     _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi64(s, 4), mask)));
+        __m256i* d = reinterpret_cast<__m256i*>(dst + i);
+        _mm256_storeu_si256(d, _mm256_xor_si256(_mm256_loadu_si256(d), p));
+    }
+    gf_mul_add_ssse3(dst + i, src + i, len - i, c);
+}
+#endif
+
+struct GfEngine {
+    const char* name;
+    GfMulAddFn mul_add;
+};
+
+GfEngine gf_engine = {"gf-table", gf_mul_add_sw};
+
+inline void gf_mul_add(uint8_t* dst, const uint8_t* src, size_t len, uint8_t c) {
+    if (c == 0) return;
+    if (c == 1) {
+        for (size_t i = 0; i < len; i++) dst[i] ^= src[i];  // XOR parity, vectorized by the compiler
+        return;
+    }
+    gf_engine.mul_add(dst, src, len, c);
+}
+
+// Builds the field tables and the coding matrix and picks the widest
+// PSHUFB the CPU has
+void init_fec() {
+    unsigned x = 1;
+    for (int i = 0; i < 255; i++) {
+        gf_exp[i] = gf_exp[i + 255] = static_cast<uint8_t>(x);
+        gf_log[x] = static_cast<uint8_t>(i);
+        x <<= 1;
+        if (x & 0x100) x ^= GF_POLY;
+    }
+    for (int c = 0; c < 256; c++) {
+        for (int n = 0; n < 16; n++) {
+            gf_nibble[c][0][n] = gf_mul(c, n);
+            gf_nibble[c][1][n] = gf_mul(c, n << 4);
+        }
+    }
+    // Cauchy entry 1 / (x_j + y_i) with x_j = FEC_MAX_DATA + j and y_i = i,
+    // column i divided by its row 0 entry
+    for (int j = 0; j < FEC_MAX_REPAIR; j++) {
+        for (int i = 0; i < FEC_MAX_DATA; i++) {
+            fec_matrix[j][i] = gf_mul(gf_inv((FEC_MAX_DATA + j) ^ i), FEC_MAX_DATA ^ i);
+        }
+    }
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2")) {
+        gf_engine = {"gf-avx2", gf_mul_add_avx2};
+    } else if (__builtin_cpu_supports("ssse3")) {
+        gf_engine = {"gf-ssse3", gf_mul_add_ssse3};
+    }
+#endif
+}
+
+struct AckInfo {
+    uint32_t cum_ack;
+    int window;
+    int sack_words;
+    uint32_t echo_seq;
+    uint8_t echo_attempt;
+    uint64_t sack[MAX_SACK_WORDS];
+};
+
+// One past the highest sequence number the frame acknowledges
+uint32_t ack_forward_edge(const AckInfo& ack) {
+    for (int w = ack.sack_words - 1; w >= 0; w--) {
+        if (ack.sack[w]) return ack.cum_ack + 1 + w * 64 + (63 - __builtin_ctzll(ack.sack[w])) + 1;
+    }
+    return ack.cum_ack;
+}
+
+bool decode_ack(const char* buf, size_t len, uint32_t conn_id, AckInfo& ack) {
+    if (len < ACK_BASE_SIZE) return false;
+    AckFrame frame;
+    memcpy(&frame, buf, min(len, sizeof(frame)));
+    if (ntohs(frame.magic) != PACKET_MAGIC || frame.version != PROTOCOL_VERSION ||
+        !(frame.flags & FLAG_ACK) || ntohl(frame.conn_id) != conn_id) {
+        return false;
+    }
+    ack.sack_words = ntohs(frame.sack_words);
+    if (ack.sack_words > MAX_SACK_WORDS || len != ACK_BASE_SIZE + ack.sack_words * sizeof(uint64_t)) {
+        return false;
+    }
+    ack.cum_ack = ntohl(frame.cum_ack);
+    ack.window = ntohs(frame.window);
+    ack.echo_seq = ntohl(frame.echo_seq);
+    ack.echo_attempt = frame.echo_attempt;
+    for (int i = 0; i < ack.sack_words; i++) {
+        ack.sack[i] = be64toh(frame.sack[i]);
+    }
+    return true;
+}
+
+// Drains every ACK frame queued on the non-blocking socket, so a burst of
+// cumulative ACKs is handled in one wakeup.
+template <typename Handler>
+void drain_acks(int sock, uint32_t conn_id, Handler on_ack) {
+    char buffer[sizeof(AckFrame)];
+    while (true) {
+        int bytes_received = recvfrom(sock, buffer, sizeof(buffer), 0, nullptr, nullptr);
+        if (bytes_received <= 0) return;
+        AckInfo ack;
+        if (decode_ack(buffer, bytes_received, conn_id, ack)) {
+            on_ack(ack);
+        } else {
+            cerr << "[Sender] Invalid ACK received\n";
+        }
+    }
+}
+
+// Log-linear histogram of RTT samples: four sub-buckets per power of two
+struct RttHistogram {
+    static const int BUCKETS = 256;
+    uint64_t buckets[BUCKETS] = {};
+    uint64_t count = 0;
+    uint64_t sum_us = 0;
+    uint64_t min_us = UINT64_MAX;
+    uint64_t max_us = 0;
+
+    static int bucket_of(uint64_t v) {
+        if (v < 4) return static_cast<int>(v);
+        int msb = 63 - __builtin_clzll(v);
+        return 4 * (msb - 1) + static_cast<int>((v >> (msb - 2)) & 3);
+    }
+
+    static uint64_t bucket_upper(int idx) {
+        if (idx < 4) return idx;
+        int msb = idx / 4 + 1;
+        return ((uint64_t(4 + idx % 4 + 1)) << (msb - 2)) - 1;
+    }
+
+    void add(uint64_t rtt_us) {
+        buckets[bucket_of(rtt_us)]++;
+        count++;
+        sum_us += rtt_us;
+        min_us = std::min(min_us, rtt_us);
+        max_us = std::max(max_us, rtt_us);
+    }
+
+    void merge(const RttHistogram& other) {
+        for (int i = 0; i < BUCKETS; i++) buckets[i] += other.buckets[i];
+        count += other.count;
+        sum_us += other.sum_us;
+        min_us = std::min(min_us, other.min_us);
+        max_us = std::max(max_us, other.max_us);
+    }
+
+    uint64_t percentile(double p) const {
+        uint64_t rank = static_cast<uint64_t>(p * count);
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += buckets[i];
+            if (seen > rank) return std::min(bucket_upper(i), max_us);
+        }
+        return max_us;
+    }
+
+    string summary() const {
+        if (count == 0) return "no samples";
+        return "min " + to_string(min_us) + " | avg " + to_string(sum_us / count) +
+               " | p50 " + to_string(percentile(0.50)) + " | p90 " + to_string(percentile(0.90)) +
+               " | p99 " + to_string(percentile(0.99)) + " | max " + to_string(max_us) +
+               " (" + to_string(count) + " samples)";
+    }
+};
+
+struct TransmissionStats {
+    int packets_sent = 0;
+    int packets_lost = 0;
+    int retransmissions = 0;
+    int recoveries = 0;           // Times the sender went back for a loss: per packet, or per window with Go-Back-N
+    int fast_recoveries = 0;      // The recoveries made by fast retransmit
+    RttHistogram rtt;      // One sample per ACK that newly acks the transmission it echoes
+    uint64_t final_rto_us = 0;
+    uint64_t send_syscalls = 0;
+    uint64_t datagrams_sent = 0;  // Everything handed to the kernel, retransmissions included
+    int fast_retransmits = 0;     // Retransmissions ahead of the RTO, on duplicate ACKs or SACK
+    int timeout_retransmits = 0;  // ...and on it
+    int congestion_events = 0;    // cwnd reductions
+    double final_cwnd = 0;        // Packets, 0 without congestion control
+    double pacing_rate_mbps = 0;  // Final pacing rate, 0 when unpaced
+    int repair_packets = 0;       // FEC repair packets, lost ones included
+    int fec_blocks = 0;
+    int final_window = 0;         // Packets, 0 unless the window was auto-tuned
+    double delivery_rate_mbps = 0;  // Bottleneck rate it was sized to
+    uint64_t min_rtt_us = 0;
+    
+    double packets_per_syscall() const {
+        return send_syscalls ? static_cast<double>(datagrams_sent) / send_syscalls : 0.0;
+    }
+
+    void merge(const TransmissionStats& other) {
+        packets_sent += other.packets_sent;
+        packets_lost += other.packets_lost;
+        retransmissions += other.retransmissions;
+        recoveries += other.recoveries;
+        fast_recoveries += other.fast_recoveries;
+        fast_retransmits += other.fast_retransmits;
+        timeout_retransmits += other.timeout_retransmits;
+        rtt.merge(other.rtt);
+        final_rto_us = max(final_rto_us, other.final_rto_us);
+        send_syscalls += other.send_syscalls;
+        datagrams_sent += other.datagrams_sent;
+        congestion_events += other.congestion_events;
+        final_cwnd += other.final_cwnd;  // The stripes' windows add up
+        pacing_rate_mbps += other.pacing_rate_mbps;
+        repair_packets += other.repair_packets;
+        fec_blocks += other.fec_blocks;
+        final_window += other.final_window;
+        delivery_rate_mbps += other.delivery_rate_mbps;
+        if (other.min_rtt_us > 0 && (min_rtt_us == 0 || other.min_rtt_us < min_rtt_us)) min_rtt_us = other.min_rtt_us;
+    }
+
+    void print(const string& title = "Transmission Statistics") const {
+        cout << "\n=== " << title << " ===\n"
+             << "Packets sent: " << packets_sent << "\n"
+             << "Packets lost: " << packets_lost << "\n"
+             << "Retransmissions: " << retransmissions << " (" << fast_retransmits << " fast, "
+             << timeout_retransmits << " on timeout)\n"
+             << "Loss recoveries: " << recoveries << " (" << fast_recoveries << " fast)\n"
+             << "RTT (us): " << rtt.summary() << "\n"
+             << "Final RTO (us): " << final_rto_us << "\n"
+             << "Send syscalls: " << send_syscalls << " (" << packets_per_syscall()
+             << " packets/call)\n";
+        if (final_cwnd > 0) {
+            cout << "Congestion events: " << congestion_events << "\n"
+                 << "Final cwnd (packets): " << final_cwnd << "\n";
+        }
+        if (pacing_rate_mbps > 0) cout << "Pacing rate (Mbit/s): " << pacing_rate_mbps << "\n";
+        if (fec_blocks > 0) {
+            cout << "FEC repair packets: " << repair_packets << " over " << fec_blocks << " blocks ("
+                 << static_cast<double>(repair_packets) / fec_blocks << " per block)\n";
+        }
+        if (final_window > 0) {
+            cout << "Final window (packets): " << final_window << " (delivery rate " << delivery_rate_mbps
+                 << " Mbit/s, min RTT " << min_rtt_us << " us)\n";
+        }
+    }
+};
+
+// cwnd or the auto-tuned window over the course of a stripe, for stat.txt.
+// Sampled at most every interval and at each congestion event; when the
+// trace fills up every other sample is dropped and the interval doubles, so
+// it always covers the whole transfer.
+struct WindowTrace {
+    vector<pair<uint64_t, double>> samples;  // Microseconds since the start, packets
+    uint64_t interval_us = TRACE_INTERVAL_US;
+    uint64_t next_us = 0;
+
+    void record(uint64_t elapsed_us, double window, bool force = false) {
+        if (!force && elapsed_us < next_us) return;
+        if (samples.size() == MAX_TRACE_SAMPLES) {
+            for (size_t i = 0; i < samples.size() / 2; i++) samples[i] = samples[2 * i];
+            samples.resize(samples.size() / 2);
+            interval_us *= 2;
+        }
+        samples.emplace_back(elapsed_us, window);
+        next_us = elapsed_us + interval_us;
+    }
+};
+
+// One stripe of a transfer: its session and slice of the sequence space,
+// and what happened to it
+struct StripeResult {
+    uint32_t conn_id = 0;
+    uint32_t first_seq = 0;
+    uint32_t end_seq = 0;   // One past its last packet
+    TransmissionStats stats;
+    uint64_t packets_acked = 0;
+    vector<uint32_t> lost_packets;  // The first MAX_LOGGED_LOSSES, for stat.txt
+    WindowTrace cwnd_trace;
+    WindowTrace window_trace;  // With --window=auto
+    PacingMode pacing = PACING_OFF;  // What the socket ended up with
+};
+
+// Completion tracker shared by the stripes of a transfer. The transfer is
+// acknowledged once every stripe has seen all of its packets acked; a
+// stripe that gives up on the receiver stays in stripes_left.
+struct TransferProgress {
+    atomic<uint64_t> packets_acked{0};
+    atomic<int> stripes_left;
+
+    explicit TransferProgress(int stripes) : stripes_left(stripes) {}
+
+    bool complete() const { return stripes_left == 0; }
+};
+
+// Per-packet send bookkeeping: the ring of in-flight slots, their
+// retransmission timers and the RTO estimator they feed
+struct RetransmitState {
+    TimerWheel timers;
+    SendRing ring;
+    RttEstimator rtt;
+    uint64_t last_ack_us = 0;  // Latest ACK that acked anything new
+    int backoffs = 0;          // Timeouts of the oldest outstanding packet since base last moved
+
+    explicit RetransmitState(int window_size)
+        : timers(TIMER_TICK_US, now_us()), ring(window_size, options.huge_pages) {}
+
+    // Takes over seq's slot for a new packet; the caller serializes it
+    SendSlot& claim(uint32_t seq_num) {
+        SendSlot& slot = ring[seq_num];
+        slot.timer.seq_num = seq_num;
+        slot.retries = 0;
+        slot.acked = false;
+        return slot;
+    }
+
+    void on_sent(SendSlot& slot, uint64_t sent_us) {
+        slot.sent_us = sent_us;
+        timers.arm(slot.timer, sent_us + rtt.rto_us());
+    }
+
+    // Applies one ACK frame in a single pass: everything below cum_ack, then
+    // each SACKed packet. Only [base, next_seq_num) is in the ring, anything
+    // else in the frame is stale. Slides base and returns the number of newly
+    // acked packets. The frame echoes the seq and attempt of the packet that
+    // prompted it, which identifies the transmission that got through even
+    // after retransmissions, so Karn's rule need not throw the sample away.
+    // It is taken once, when that packet is first acked, and only if the
+    // echo matches its latest transmission.
+    int apply_ack(const AckInfo& ack, uint32_t& base, uint32_t next_seq_num,
+                  TransmissionStats& stats) {
+        int newly_acked = 0;
+        const SendSlot* echoed = nullptr;
+        const SendSlot* sample = nullptr;
+        if (!seq_before(ack.echo_seq, base) && seq_before(ack.echo_seq, next_seq_num)) {
+            const SendSlot& slot = ring[ack.echo_seq];
+            if (slot.sent_us != 0 && ack.echo_attempt == min<int>(slot.retries, 255)) echoed = &slot;
+        }
+        auto mark = [&](uint32_t seq) {
+            SendSlot& slot = ring[seq];
+            if (slot.acked) return;
+            slot.acked = true;
+            timers.cancel(slot.timer);
+            if (&slot == echoed) sample = &slot;
+            newly_acked++;
+        };
+
+        uint32_t cum_end = seq_before(ack.cum_ack, next_seq_num) ? ack.cum_ack : next_seq_num;
+        for (uint32_t seq = base; seq_before(seq, cum_end); seq++) {
+            mark(seq);
+        }
+        for (int w = 0; w < ack.sack_words; w++) {
+            uint64_t bits = ack.sack[w];
+            while (bits) {
+                int bit = __builtin_clzll(bits);
+                bits &= ~(uint64_t(1) << (63 - bit));
+                uint32_t seq = ack.cum_ack + 1 + w * 64 + bit;
+                if (!seq_before(seq, base) && seq_before(seq, next_seq_num)) mark(seq);
+            }
+        }
+        if (newly_acked > 0) last_ack_us = now_us();
+        uint32_t previous_base = base;
+        while (base != next_seq_num && ring[base].acked) {
+            base++;
+        }
+        if (base != previous_base) {
+            rtt.on_progress();
+            backoffs = 0;
+        }
+
+        if (sample) {
+            uint64_t sample_us = now_us() - sample->sent_us;
+            rtt.add_sample(sample_us);
+            stats.rtt.add(sample_us);
+        }
+        stats.final_rto_us = rtt.rto_us();
+        return newly_acked;
+    }
+
+    // A timer that fires although ACKs have acked new data since its packet
+    // went out is pushed back to an RTO after the latest of them, as RFC
+    // 6298 restarts its single timer: the path is moving, and the packet
+    // may only be waiting on a delayed or coalesced ACK. Losses the ACKs do
+    // show are fast retransmitted. Returns whether the timer was re-armed.
+    bool defer(SendSlot& slot) {
+        if (last_ack_us <= slot.sent_us) return false;
+        uint64_t deadline = last_ack_us + rtt.rto_us();
+        if (deadline <= now_us()) return false;
+        timers.arm(slot.timer, deadline);
+        return true;
+    }
+
+    void on_retransmitted(SendSlot& slot, bool oldest_outstanding) {
+        if (oldest_outstanding) {
+            rtt.backoff();
+            backoffs++;
+        }
+        slot.retries++;
+        slot.sent_us = now_us();
+        timers.arm(slot.timer, slot.sent_us + rtt.rto_us());
+    }
+};
+
+// FEC encoder of one stripe (--fec). Every data packet is multiplied into
+// its block's repair symbols the first time it goes out, so payloads are
+// never kept around; the symbols accumulate in place in the repair
+// datagrams, which are complete when the block's last packet has been
+// added. Repairs go out once, right behind their block, and are never
+// acked or resent.
+//
+// Unless --fec fixes the count, a block gets enough repairs for the
+// expected losses plus two standard deviations, from an EWMA of the holes
+// the receiver's SACK bitmaps show per data packet; never fewer than the
+// XOR parity packet.
+class FecEncoder {
+    const uint32_t conn_id;
+    const uint32_t first_seq, end_seq;  // The stripe
+    const int block_size;
+    const int max_repairs;
+    const bool adaptive;
+    size_t pool_blocks;        // Blocks whose repairs can be in flight at once
+    vector<char> pool;         // Their repair datagrams, max_repairs per block
+    vector<uint8_t> sent;      // And how many repairs each one got
+    char* repairs = nullptr;   // The current block's
+    int repair_count = 0;
+    int data_count = 0;        // Packets added to the current block so far
+    size_t coded_len = 0;      // Its longest symbol
+    double loss_rate = 0;      // Holes per data packet
+    int holes = 0;             // Seen since the last block was finished
+
+    char* symbol(int j) { return repairs + j * REPAIR_PACKET_SIZE + HEADER_SIZE + sizeof(FecHeader); }
+
+    int choose_repairs() const {
+        if (!adaptive) return max_repairs;
+        double expected = loss_rate * block_size;
+        int count = static_cast<int>(ceil(expected + 2 * sqrt(expected * (1 - loss_rate))));
+        return min(max(count, 1), max_repairs);
+    }
+public:
+    // The window bounds how far ahead of an unacked block the sender gets,
+    // so a block's datagrams are only reused once the window has moved a
+    // whole block past it
+    FecEncoder(uint32_t id, uint32_t first, uint32_t end, int window_size)
+        : conn_id(id), first_seq(first), end_seq(end), block_size(options.fec_block),
+          max_repairs(options.fec_repairs > 0 ? options.fec_repairs : min(block_size, FEC_MAX_REPAIR)),
+          adaptive(options.fec_repairs == 0),
+          pool_blocks(window_size / block_size + 2),
+          pool(pool_blocks * max_repairs * REPAIR_PACKET_SIZE), sent(pool_blocks) {}
+
+    int current_repairs() const { return repair_count; }
+
+    // First packet of the block seq belongs to
+    uint32_t block_start(uint32_t seq) const {
+        return first_seq + seq_diff(seq, first_seq) / block_size * block_size;
+    }
+
+    // One past the last packet of the block starting at block_first
+    uint32_t block_end(uint32_t block_first) const {
+        return seq_diff(end_seq, block_first) < block_size ? end_seq : block_first + block_size;
+    }
+
+    // Repair packets the completed block starting at block_first went out with
+    int repairs_for(uint32_t block_first) const {
+        return sent[seq_diff(block_first, first_seq) / block_size % pool_blocks];
+    }
+
+    void on_holes(int count) { holes += count; }
+
+    // Adds the next data packet. True once it completes its block (the
+    // stripe's last packet ends the last, shorter one), and the block's
+    // repair datagrams are ready for repair().
+    bool add(uint32_t seq, const char* payload, size_t len, bool fin) {
+        if (data_count == 0) {
+            size_t block = seq_diff(seq, first_seq) / block_size % pool_blocks;
+            repairs = &pool[block * max_repairs * REPAIR_PACKET_SIZE];
+            repair_count = choose_repairs();
+            sent[block] = static_cast<uint8_t>(repair_count);
+            coded_len = 0;
+            for (int j = 0; j < repair_count; j++) memset(symbol(j), 0, FEC_SYMBOL_SIZE);
+        }
+        uint8_t prefix[FEC_SYMBOL_PREFIX] = {static_cast<uint8_t>(len >> 8), static_cast<uint8_t>(len),
+                                            static_cast<uint8_t>(fin ? FLAG_FIN : 0), 0};
+        for (int j = 0; j < repair_count; j++) {
+            uint8_t c = fec_matrix[j][data_count];
+            uint8_t* sym = reinterpret_cast<uint8_t*>(symbol(j));
+            gf_mul_add(sym, prefix, FEC_SYMBOL_PREFIX, c);
+            gf_mul_add(sym + FEC_SYMBOL_PREFIX, reinterpret_cast<const uint8_t*>(payload), len, c);
+        }
+        coded_len = max(coded_len, FEC_SYMBOL_PREFIX + len);
+        data_count++;
+        if (data_count < block_size && seq + 1 != end_seq) return false;
+
+        uint32_t block_first = seq - (data_count - 1);
+        for (int j = 0; j < repair_count; j++) {
+            FecHeader fec = {static_cast<uint8_t>(data_count), static_cast<uint8_t>(j),
+                             static_cast<uint8_t>(repair_count), 0};
+            char* packet = repairs + j * REPAIR_PACKET_SIZE;
+            memcpy(packet + HEADER_SIZE, &fec, sizeof(fec));
+            encode_header(packet, conn_id, block_first, packet + HEADER_SIZE,
+                          sizeof(fec) + coded_len, FLAG_REPAIR);
+        }
+        loss_rate += FEC_LOSS_GAIN * (static_cast<double>(holes) / data_count - loss_rate);
+        holes = 0;
+        data_count = 0;
+        return true;
+    }
+
+    // Repair datagram j of the block add() just completed
+    const char* repair(int j, size_t& len) const {
+        len = HEADER_SIZE + sizeof(FecHeader) + coded_len;
+        return repairs + j * REPAIR_PACKET_SIZE;
+    }
+};
+
+// Payload of every generated test packet. Segmentation offload needs
+// equal-sized datagrams, so with --gso it is padded to a full PACKET_SIZE.
+const string& test_payload() {
+    static const string small = "test";
+    static const string full = string("test").append(MAX_PAYLOAD_SIZE - 4, '\0');
+    return options.gso ? full : small;
+}
+
+// Room for another packet under both the flow-control window and cwnd
+bool can_send(uint32_t next_seq_num, uint32_t base, int window_size, double cwnd) {
+    int limit = min(window_size, max(static_cast<int>(cwnd), 1));
+    return seq_diff(next_seq_num, base) < limit;
+}
+
+enum Protocol {
+    STOP_AND_WAIT,
+    GO_BACK_N,
+    SELECTIVE_REPEAT
+};
+
+void log_statistics(const TransmissionStats& stats, int total_packets, int window_size, uint64_t packets_acked,
+                    const vector<uint32_t>& lost_packets, const vector<StripeResult>& stripes) {
+    ofstream stat_file("stat.txt");
+    if (!stat_file.is_open()) {
+        cerr << "[ERROR] Failed to open stat.txt for writing\n";
+        return;
+    }
+
+    stat_file << "Total Packets: " << total_packets << "\n";
+    if (stats.final_window > 0) {
+        stat_file << "Window Size: auto (final " << stats.final_window << ")\n";
+    } else {
+        stat_file << "Window Size: " << window_size << "\n";
+    }
+    stat_file << "Packets Sent: " << stats.packets_sent << "\n";
+    stat_file << "Packets Lost: " << stats.packets_lost << "\n";
+    stat_file << "Retransmissions: " << stats.retransmissions << "\n";
+    stat_file << "Fast Retransmits: " << stats.fast_retransmits << "\n";
+    stat_file << "Timeout Retransmits: " << stats.timeout_retransmits << "\n";
+    stat_file << "Loss Recoveries: " << stats.recoveries << "\n";
+    stat_file << "Fast Recoveries: " << stats.fast_recoveries << "\n";
+    stat_file << "RTT (us): " << stats.rtt.summary() << "\n";
+    stat_file << "Packets Per Send Syscall: " << stats.packets_per_syscall() << "\n";
+    stat_file << "ACK Received: " << packets_acked << "/" << total_packets << "\n";
+    stat_file << "Lost Packets: ";
+    for (uint32_t lost : lost_packets) {
+        stat_file << lost << " ";
+    }
+    if (stats.packets_lost > static_cast<int>(lost_packets.size())) {
+        stat_file << "(+" << stats.packets_lost - lost_packets.size() << " more)";
+    }
+    stat_file << "\n";
+    if (stripes.size() > 1) {
+        stat_file << "Stripes: " << stripes.size() << "\n";
+        for (size_t i = 0; i < stripes.size(); i++) {
+            const StripeResult& stripe = stripes[i];
+            stat_file << "Stripe " << i << ": conn " << hex << stripe.conn_id << dec
+                      << " | packets " << stripe.first_seq << "-" << stripe.end_seq - 1
+                      << " | sent " << stripe.stats.packets_sent
+                      << " | lost " << stripe.stats.packets_lost
+                      << " | retransmissions " << stripe.stats.retransmissions
+                      << " | acked " << stripe.packets_acked
+                      << " | RTT p50 " << (stripe.stats.rtt.count ? stripe.stats.rtt.percentile(0.50) : 0)
+                      << " us\n";
+        }
+    }
+    if (stats.pacing_rate_mbps > 0) {
+        stat_file << "Pacing: " << PACING_MODE_NAMES[stripes[0].pacing] << ", final rate "
+                  << stats.pacing_rate_mbps << " Mbit/s\n";
+    }
+    if (stats.fec_blocks > 0) {
+        stat_file << "FEC Block Size: " << options.fec_block << "\n";
+        stat_file << "FEC Repair Packets: " << stats.repair_packets << "\n";
+        stat_file << "FEC Repairs Per Block: " << static_cast<double>(stats.repair_packets) / stats.fec_blocks << "\n";
+    }
+    if (options.cc != CC_NONE) {
+        stat_file << "Congestion Control: " << CONGESTION_ALGORITHM_NAMES[options.cc] << "\n";
+        stat_file << "Congestion Events: " << stats.congestion_events << "\n";
+        for (size_t i = 0; i < stripes.size(); i++) {
+            if (stripes.size() > 1) stat_file << "Stripe " << i << " ";
+            stat_file << "Cwnd (ms:packets): ";
+            for (const auto& sample : stripes[i].cwnd_trace.samples) {
+                stat_file << sample.first / 1000 << ":" << static_cast<int>(sample.second) << " ";
+            }
+            stat_file << "\n";
+        }
+    }
+    if (stats.final_window > 0) {
+        stat_file << "Delivery Rate (Mbit/s): " << stats.delivery_rate_mbps << "\n";
+        stat_file << "Min RTT (us): " << stats.min_rtt_us << "\n";
+        for (size_t i = 0; i < stripes.size(); i++) {
+            if (stripes.size() > 1) stat_file << "Stripe " << i << " ";
+            stat_file << "Window (ms:packets): ";
+            for (const auto& sample : stripes[i].window_trace.samples) {
+                stat_file << sample.first / 1000 << ":" << static_cast<int>(sample.second) << " ";
+            }
+            stat_file << "\n";
+        }
+    }
+    stat_file.close();
+}
+
+bool would_block(int err) {
+    return err == EAGAIN || err == EWOULDBLOCK || err == ENOBUFS;
+}
+
+// Collects datagrams bound for one destination and hands them to the kernel
+// with a single sendmmsg(). A datagram is one or two iovecs (header and
+// payload), so payloads can be sent straight from where they live. Queued
+// data must stay valid until it is flushed.
+//
+// With a non-zero gso_size, runs of gso_size-byte datagrams (plus at most one
+// shorter one at the end) are sent as one message with a UDP_SEGMENT cmsg and
+// the kernel or NIC cuts them back into separate datagrams.
+//
+// A datagram with a departure time carries it in an SCM_TXTIME cmsg; a GSO
+// message leaves at the time of its first datagram.
+class TxBatch {
+    vector<mmsghdr> msgs;
+    vector<iovec> iovs;        // Two slots per datagram
+    vector<size_t> lens;       // Per queued datagram
+    vector<uint8_t> parts;     // iovecs used by each queued datagram
+    vector<uint64_t> txtimes;  // SO_TXTIME departure per queued datagram, 0 for none
+    vector<size_t> msg_datagrams;  // Datagrams carried by each prepared message
+    vector<char> controls;     // UDP_SEGMENT and SCM_TXTIME cmsg slots per message
+    size_t count = 0;
+    size_t iov_count = 0;
+    sockaddr_in dest;
+    uint16_t gso_size;
+
+    static const size_t CONTROL_SPACE = CMSG_SPACE(sizeof(uint16_t)) + CMSG_SPACE(sizeof(uint64_t));
+
+    // Segments per message: bounded by the kernel limit and the largest UDP payload
+    size_t max_segments() const {
+        return min<size_t>(GSO_MAX_SEGMENTS, GSO_MAX_BYTES / gso_size);
+    }
+
+    // Starting at datagram first, how many datagrams can share one message
+    size_t segments_from(size_t first) const {
+        if (gso_size == 0 || lens[first] != gso_size) return 1;
+        size_t limit = min(count - first, max_segments());
+        size_t n = 1;
+        while (n < limit && lens[first + n] == gso_size) n++;
+        if (n < limit && lens[first + n] < gso_size) n++;
+        return n;
+    }
+public:
+    TxBatch(size_t capacity, const sockaddr_in& addr, uint16_t gso = 0)
+        : msgs(max<size_t>(capacity, 1)), iovs(2 * msgs.size()), lens(msgs.size()),
+          parts(msgs.size()), txtimes(msgs.size()), msg_datagrams(msgs.size()),
+          controls(msgs.size() * CONTROL_SPACE), dest(addr), gso_size(gso) {}
+
+    bool empty() const { return count == 0; }
+    bool full() const { return count == msgs.size(); }
+
+    void add(const char* data, size_t len, const char* payload = nullptr, size_t payload_len = 0,
+             uint64_t txtime = 0) {
+        iovs[iov_count++] = {const_cast<char*>(data), len};
+        parts[count] = 1;
+        if (payload_len > 0) {
+            iovs[iov_count++] = {const_cast<char*>(payload), payload_len};
+            parts[count] = 2;
+        }
+        lens[count] = len + payload_len;
+        txtimes[count] = txtime;
+        count++;
+    }
+
+    // Lays the queued datagrams out as messages and returns how many
+    size_t prepare() {
+        size_t messages = 0;
+        size_t iov = 0;
+        for (size_t i = 0; i < count; i += msg_datagrams[messages++]) {
+            size_t n = segments_from(i);
+            msg_datagrams[messages] = n;
+            msghdr& hdr = msgs[messages].msg_hdr;
+            memset(&hdr, 0, sizeof(hdr));
+            hdr.msg_name = &dest;
+            hdr.msg_namelen = sizeof(dest);
+            hdr.msg_iov = &iovs[iov];
+            for (size_t d = i; d < i + n; d++) hdr.msg_iovlen += parts[d];
+            iov += hdr.msg_iovlen;
+            if (n > 1 || txtimes[i] != 0) {
+                char* control = &controls[messages * CONTROL_SPACE];
+                size_t used = 0;
+                if (n > 1) {
+                    cmsghdr* cm = reinterpret_cast<cmsghdr*>(control);
+                    cm->cmsg_level = SOL_UDP;
+                    cm->cmsg_type = UDP_SEGMENT;
+                    cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                    memcpy(CMSG_DATA(cm), &gso_size, sizeof(gso_size));
+                    used += CMSG_SPACE(sizeof(uint16_t));
+                }
+                if (txtimes[i] != 0) {
+                    cmsghdr* cm = reinterpret_cast<cmsghdr*>(control + used);
+                    cm->cmsg_level = SOL_SOCKET;
+                    cm->cmsg_type = SCM_TXTIME;
+                    cm->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+                    memcpy(CMSG_DATA(cm), &txtimes[i], sizeof(uint64_t));
+                    used += CMSG_SPACE(sizeof(uint64_t));
+                }
+                hdr.msg_control = control;
+                hdr.msg_controllen = used;
+            }
+        }
+        return messages;
+    }
 
-atomic<bool> is_running{true};
+    mmsghdr& message(size_t i) { return msgs[i]; }
 
-// Utility functions
-void handle_error(const string& msg) {
-    cerr << "[ERROR] " << msg << ": " << strerror(errno) << endl;
-    exit(1);
-}
+    // Drops the first `sent` messages from the batch; returns the datagrams they carried
+    size_t consume(size_t sent) {
+        size_t datagrams = 0, used_iovs = 0;
+        for (size_t m = 0; m < sent; m++) {
+            datagrams += msg_datagrams[m];
+            used_iovs += msgs[m].msg_hdr.msg_iovlen;
+        }
+        count -= datagrams;
+        iov_count -= used_iovs;
+        memmove(iovs.data(), iovs.data() + used_iovs, iov_count * sizeof(iovec));
+        memmove(lens.data(), lens.data() + datagrams, count * sizeof(size_t));
+        memmove(parts.data(), parts.data() + datagrams, count);
+        memmove(txtimes.data(), txtimes.data() + datagrams, count * sizeof(uint64_t));
+        return datagrams;
+    }
 
-class AdaptiveTimeout {
-    int current_ms = 1000;
-    const int min_ms, max_ms;
-public:
-    AdaptiveTimeout(int min = MIN_TIMEOUT_MS, int max = MAX_TIMEOUT_MS) 
-        : min_ms(min), max_ms(max) {}
-    
-    void decrease() { current_ms = std::max(current_ms / 2, min_ms); }
-    void increase() { current_ms = std::min(current_ms * 2, max_ms); }
-    int get() const { return current_ms; }
+    // Sends as much of the batch as the socket accepts. Unsent datagrams stay
+    // queued in order; returns false on a full socket buffer.
+    bool flush(int sock, TransmissionStats& stats) {
+        if (count == 0) return true;
+        int sent = sendmmsg(sock, msgs.data(), prepare(), 0);
+        if (sent < 0) {
+            if (!would_block(errno)) handle_error("sendmmsg failed");
+            return false;
+        }
+        stats.send_syscalls++;
+        stats.datagrams_sent += consume(sent);
+        return count == 0;
+    }
 };
 
-class PacketBuffer {
-    vector<string> packets;
-    mutex mtx;
+// True if the kernel accepts UDP_SEGMENT on this socket. Setting it to 0 keeps
+// the socket default (no segmentation); messages opt in through their cmsg.
+bool gso_supported(int sock) {
+    int off = 0;
+    return setsockopt(sock, SOL_UDP, UDP_SEGMENT, &off, sizeof(off)) == 0;
+}
+
+// Minimal io_uring over the raw syscalls: the submission and completion
+// rings mapped into the process and one registered file (index 0).
+class IoUring {
+    int ring_fd;
+    bool sqpoll;
+    void* sq_map = MAP_FAILED;
+    void* cq_map = MAP_FAILED;
+    size_t sq_map_len = 0, cq_map_len = 0, sqes_len = 0;
+    io_uring_sqe* sqes = nullptr;
+    unsigned *sq_head, *sq_tail, *sq_flags;
+    unsigned sq_mask, sq_entries;
+    unsigned *cq_head, *cq_tail;
+    unsigned cq_mask;
+    io_uring_cqe* cqes;
+    unsigned sqe_tail = 0;       // Next free SQE; published to the kernel by submit()
 public:
-    explicit PacketBuffer(size_t size) : packets(size) {}
-    
-    void store(int seq_num, const string& packet) {
-        lock_guard<mutex> lock(mtx);
-        packets[seq_num] = packet;
+    uint64_t enters = 0;         // io_uring_enter() calls made so far
+
+    IoUring(unsigned entries, bool use_sqpoll) : sqpoll(use_sqpoll) {
+        io_uring_params params{};
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * URING_CQ_FACTOR;
+        if (sqpoll) {
+            params.flags |= IORING_SETUP_SQPOLL;
+            params.sq_thread_idle = URING_SQPOLL_IDLE_MS;
+        }
+        ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+        if (ring_fd < 0) handle_error("io_uring_setup failed");
+
+        sq_map_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_map_len = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) sq_map_len = cq_map_len = max(sq_map_len, cq_map_len);
+        sq_map = mmap(nullptr, sq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd, IORING_OFF_SQ_RING);
+        cq_map = single_mmap ? sq_map
+                             : mmap(nullptr, cq_map_len, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        sqes_len = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqe_map = mmap(nullptr, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring_fd, IORING_OFF_SQES);
+        if (sq_map == MAP_FAILED || cq_map == MAP_FAILED || sqe_map == MAP_FAILED) {
+            handle_error("io_uring mmap failed");
+        }
+        sqes = static_cast<io_uring_sqe*>(sqe_map);
+
+        char* sq = static_cast<char*>(sq_map);
+        sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_flags = reinterpret_cast<unsigned*>(sq + params.sq_off.flags);
+        sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_entries = params.sq_entries;
+        unsigned* sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        for (unsigned i = 0; i < sq_entries; i++) sq_array[i] = i;
+
+        char* cq = static_cast<char*>(cq_map);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        sqe_tail = *sq_tail;
     }
-    
-    string get(int seq_num) {
-        lock_guard<mutex> lock(mtx);
-        return packets[seq_num];
+
+    ~IoUring() {
+        munmap(sqes, sqes_len);
+        if (cq_map != sq_map) munmap(cq_map, cq_map_len);
+        munmap(sq_map, sq_map_len);
+        close(ring_fd);
     }
-};
 
-int create_udp_socket() {
-    int sock = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sock < 0) {
-        handle_error("Socket creation failed");
+    int fd() const { return ring_fd; }
+
+    void register_file(int file) {
+        if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_FILES, &file, 1) < 0) {
+            handle_error("IORING_REGISTER_FILES failed");
+        }
     }
-    
-    // Set socket options
-    int reuse = 1;
-    if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0) {
-        handle_error("setsockopt(SO_REUSEADDR) failed");
+
+    // A zeroed SQE to fill in; submits queued ones first if the ring is full
+    io_uring_sqe* get_sqe() {
+        while (sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+            submit();
+        }
+        io_uring_sqe* sqe = &sqes[sqe_tail & sq_mask];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe_tail++;
+        return sqe;
     }
-    
-    // Add send buffer optimization
-    int send_buff_size = SEND_BUFFER_SIZE;
-    if (setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &send_buff_size, sizeof(send_buff_size)) < 0) {
-        handle_error("setsockopt(SO_SNDBUF) failed");
+
+    // Hands queued SQEs to the kernel and, with wait_nr > 0, waits for that
+    // many completions or timeout_us. Skips the syscall when there is nothing
+    // to do (SQPOLL picks up new entries by itself). False on timeout.
+    bool submit(unsigned wait_nr = 0, uint64_t timeout_us = UINT64_MAX) {
+        unsigned to_submit = sqe_tail - *sq_tail;
+        __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+        unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+        if (sqpoll) {
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            if (__atomic_load_n(sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) {
+                flags |= IORING_ENTER_SQ_WAKEUP;
+            }
+            if (flags == 0) return true;
+        } else if (to_submit == 0 && wait_nr == 0) {
+            return true;
+        }
+
+        __kernel_timespec ts{};
+        io_uring_getevents_arg arg{};
+        const void* argp = nullptr;
+        size_t argsz = 0;
+        if (wait_nr && timeout_us != UINT64_MAX) {
+            ts.tv_sec = timeout_us / 1000000;
+            ts.tv_nsec = (timeout_us % 1000000) * 1000;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+            flags |= IORING_ENTER_EXT_ARG;
+            argp = &arg;
+            argsz = sizeof(arg);
+        }
+        enters++;
+        if (syscall(__NR_io_uring_enter, ring_fd, to_submit, wait_nr, flags, argp, argsz) < 0) {
+            if (errno == ETIME) return false;
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                handle_error("io_uring_enter failed");
+            }
+        }
+        return true;
     }
-    
-    // Enable keep-alive
-    int keepalive = 1;
-    if (setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &keepalive, sizeof(keepalive)) < 0) {
-        handle_error("setsockopt(SO_KEEPALIVE) failed");
+
+    bool cq_ready() const {
+        return *cq_head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
     }
-    
-    return sock;
-}
 
-void configure_socket_timeout(int sock, int timeout_sec) {
-    struct timeval tv;
-    tv.tv_sec = timeout_sec;
-    tv.tv_usec = 0;
-    if (setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0) {
-        perror("Setsockopt failed");
-        exit(1);
+    // Passes every ready completion to handler and consumes them
+    template <typename Handler>
+    void reap(Handler handler) {
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            handler(cqes[head & cq_mask]);
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
     }
-}
+};
 
-bool simulate_packet_loss() {
-    static random_device rd;
-    static mt19937 gen(rd());
-    static uniform_real_distribution<> dis(0, 1);
-    return dis(gen) < 0.1; // 10% packet loss rate
-}
+// Receive buffers registered with the kernel as a provided-buffer ring
+// (IORING_REGISTER_PBUF_RING). A multishot recvmsg picks the next free one
+// for each datagram, and the buffer goes back on the ring once consumed.
+class ProvidedBuffers {
+    io_uring_buf* ring;
+    size_t ring_len;
+    unsigned entries;
+    size_t buf_size;
+    vector<char> storage;
+    uint16_t tail = 0;
 
-string create_packet_with_checksum(int seq_num, const string& data) {
-    int checksum = 0;
-    for (char c : data) {
-        checksum += c;
+    void add(unsigned bid) {
+        io_uring_buf& buf = ring[tail & (entries - 1)];
+        buf.addr = reinterpret_cast<uint64_t>(buffer(bid));
+        buf.len = buf_size;
+        buf.bid = bid;
+        tail++;
     }
-    return to_string(seq_num) + ":" + data + ":" + to_string(checksum);
-}
 
-struct TransmissionStats {
-    int packets_sent;
-    int packets_lost;
-    int retransmissions;
-    
-    void print() {
-        cout << "\n=== Transmission Statistics ===\n"
-             << "Packets sent: " << packets_sent << "\n"
-             << "Packets lost: " << packets_lost << "\n"
-             << "Retransmissions: " << retransmissions << "\n";
+    void publish() {
+        __atomic_store_n(&reinterpret_cast<io_uring_buf_ring*>(ring)->tail, tail, __ATOMIC_RELEASE);
     }
-};
+public:
+    const uint16_t group;
+
+    // count must be a power of two
+    ProvidedBuffers(IoUring& uring, uint16_t group_id, unsigned count, size_t size)
+        : ring_len(count * sizeof(io_uring_buf)), entries(count), buf_size(size),
+          storage(count * size), group(group_id) {
+        void* mem = mmap(nullptr, ring_len, PROT_READ | PROT_WRITE,
+                         MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+        if (mem == MAP_FAILED) handle_error("buffer ring mmap failed");
+        ring = static_cast<io_uring_buf*>(mem);
 
-// Helper functions for packet management
-string create_packet_with_message(int seq_num, const string& message = "test") {
-    int checksum = 0;
-    for(char c : message) {
-        checksum += c;
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+        reg.ring_entries = entries;
+        reg.bgid = group;
+        if (syscall(__NR_io_uring_register, uring.fd(), IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+            handle_error("IORING_REGISTER_PBUF_RING failed");
+        }
+        for (unsigned bid = 0; bid < entries; bid++) add(bid);
+        publish();
     }
-    return to_string(seq_num) + ":" + message + ":" + to_string(checksum);
-}
 
-// Replace existing create_packet function
-string create_packet(int seq_num) {
-    return create_packet_with_message(seq_num);
-}
+    ~ProvidedBuffers() { munmap(ring, ring_len); }
 
-bool can_send(int next_seq_num, int base, int window_size) {
-    return next_seq_num < base + window_size;
-}
+    char* buffer(unsigned bid) { return &storage[bid * buf_size]; }
 
-enum Protocol {
-    STOP_AND_WAIT,
-    GO_BACK_N,
-    SELECTIVE_REPEAT
+    void recycle(unsigned bid) {
+        add(bid);
+        publish();
+    }
 };
 
-void log_statistics(const TransmissionStats& stats, int total_packets, int window_size, const vector<bool>& ack_received, const vector<int>& lost_packets) {
-    ofstream stat_file("stat.txt");
-    if (!stat_file.is_open()) {
-        cerr << "[ERROR] Failed to open stat.txt for writing\n";
-        return;
+// io_uring event loop for the sender. Datagrams go out as sendmsg SQEs,
+// ACKs arrive through a multishot recvmsg on provided buffers and the
+// retransmission timer is an IORING_OP_TIMEOUT set to the timer wheel's next
+// deadline, so one io_uring_enter() both submits and waits.
+class UringSender {
+    static const uint64_t SEND_TAG = 1;
+    static const uint64_t RECV_TAG = 2;
+    static const uint64_t TIMEOUT_TAG = 3;
+    static const uint64_t TIMEOUT_UPDATE_TAG = 4;
+
+    IoUring ring;
+    uint32_t conn_id;                // Session whose ACKs are accepted
+    msghdr recv_template{};          // No name or control space, just the ACK frame
+    ProvidedBuffers buffers;
+    bool recv_armed = false;
+    uint64_t armed_deadline_us = 0;  // Deadline of the pending timeout, 0 if none
+    __kernel_timespec timeout_ts{};
+    uint64_t counted_enters = 0;
+    size_t sends_in_flight = 0;      // sendmsg SQEs whose completion is still due
+    vector<io_uring_cqe> deferred;   // Completions reaped but not yet dispatched
+    vector<io_uring_cqe> ready;      // What wait() is dispatching
+
+    void arm_recv() {
+        io_uring_sqe* sqe = ring.get_sqe();
+        sqe->opcode = IORING_OP_RECVMSG;
+        sqe->fd = 0;
+        sqe->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->addr = reinterpret_cast<uint64_t>(&recv_template);
+        sqe->len = 1;
+        sqe->buf_group = buffers.group;
+        sqe->user_data = RECV_TAG;
+        recv_armed = true;
+    }
+public:
+    UringSender(int sock, uint32_t id)
+        : ring(URING_ENTRIES, false), conn_id(id),
+          buffers(ring, 0, URING_ACK_BUFFERS, sizeof(io_uring_recvmsg_out) + sizeof(AckFrame)) {
+        ring.register_file(sock);
+        arm_recv();
+        ring.submit();
     }
 
-    stat_file << "Total Packets: " << total_packets << "\n";
-    stat_file << "Window Size: " << window_size << "\n";
-    stat_file << "Packets Sent: " << stats.packets_sent << "\n";
-    stat_file << "Packets Lost: " << stats.packets_lost << "\n";
-    stat_file << "Retransmissions: " << stats.retransmissions << "\n";
-    stat_file << "ACK Received: ";
-    for (bool ack : ack_received) {
-        stat_file << ack << " ";
+    // Queues the whole batch as sendmsg SQEs and waits for their completions.
+    // A send the kernel cannot finish inline is punted to a worker that reads
+    // the msghdr, iovecs and ring slot headers later, so none of them may be
+    // reused or rewritten before its CQE arrives. ACK and timeout completions
+    // that turn up meanwhile are kept for wait().
+    void send(TxBatch& batch, TransmissionStats& stats) {
+        if (batch.empty()) return;
+        size_t messages = batch.prepare();
+        for (size_t i = 0; i < messages; i++) {
+            io_uring_sqe* sqe = ring.get_sqe();
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = 0;
+            sqe->flags = IOSQE_FIXED_FILE;
+            sqe->addr = reinterpret_cast<uint64_t>(&batch.message(i).msg_hdr);
+            sqe->len = 1;
+            sqe->user_data = SEND_TAG;
+        }
+        sends_in_flight += messages;
+        while (sends_in_flight > 0) {
+            ring.submit(ring.cq_ready() ? 0 : 1);
+            ring.reap([&](const io_uring_cqe& cqe) {
+                if (cqe.user_data != SEND_TAG) {
+                    deferred.push_back(cqe);
+                    return;
+                }
+                sends_in_flight--;
+                if (cqe.res < 0) cerr << "[Sender] sendmsg failed: " << strerror(-cqe.res) << "\n";
+            });
+        }
+        stats.datagrams_sent += batch.consume(messages);
     }
-    stat_file << "\nLost Packets: ";
-    for (int lost : lost_packets) {
-        stat_file << lost << " ";
+
+    // Moves the pending timeout to deadline_us. No deadline (0) leaves it
+    // alone; expiring with nothing due is harmless.
+    void arm_timeout(uint64_t deadline_us) {
+        if (deadline_us == 0 || deadline_us == armed_deadline_us) return;
+        timeout_ts.tv_sec = deadline_us / 1000000;
+        timeout_ts.tv_nsec = (deadline_us % 1000000) * 1000;
+        io_uring_sqe* sqe = ring.get_sqe();
+        if (armed_deadline_us == 0) {
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->addr = reinterpret_cast<uint64_t>(&timeout_ts);
+            sqe->len = 1;
+            sqe->user_data = TIMEOUT_TAG;
+        } else {
+            sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+            sqe->addr = TIMEOUT_TAG;
+            sqe->addr2 = reinterpret_cast<uint64_t>(&timeout_ts);
+            sqe->timeout_flags = IORING_TIMEOUT_UPDATE;
+            sqe->user_data = TIMEOUT_UPDATE_TAG;
+        }
+        sqe->timeout_flags |= IORING_TIMEOUT_ABS;  // CLOCK_MONOTONIC, same clock as now_us()
+        armed_deadline_us = deadline_us;
+    }
+
+    // Submits what is queued, waits for at least one completion unless
+    // some are already set aside, and dispatches everything that is ready
+    template <typename AckHandler, typename TimeoutHandler>
+    void wait(TransmissionStats& stats, AckHandler on_ack, TimeoutHandler on_expired) {
+        auto dispatch = [&](const io_uring_cqe& cqe) {
+            switch (cqe.user_data) {
+            case RECV_TAG:
+                if (!(cqe.flags & IORING_CQE_F_MORE)) recv_armed = false;
+                if (cqe.flags & IORING_CQE_F_BUFFER) {
+                    unsigned bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+                    const char* buf = buffers.buffer(bid);
+                    const io_uring_recvmsg_out* out = reinterpret_cast<const io_uring_recvmsg_out*>(buf);
+                    size_t len = cqe.res > static_cast<int>(sizeof(*out))
+                                     ? min<size_t>(out->payloadlen, cqe.res - sizeof(*out)) : 0;
+                    AckInfo ack;
+                    if (decode_ack(buf + sizeof(*out), len, conn_id, ack)) {
+                        on_ack(ack);
+                    } else {
+                        cerr << "[Sender] Invalid ACK received\n";
+                    }
+                    buffers.recycle(bid);
+                }
+                break;
+            case TIMEOUT_TAG:
+                if (cqe.res == -ETIME) {
+                    armed_deadline_us = 0;
+                    on_expired();
+                }
+                break;
+            case TIMEOUT_UPDATE_TAG:
+                break;  // -ENOENT means it already fired; that completion re-arms it
+            }
+        };
+        // Everything is taken off the ring before any handler runs, since
+        // handlers send and send() reaps. What send() sets aside meanwhile
+        // waits for the next call, which then does not block.
+        ring.submit(ring.cq_ready() || !deferred.empty() ? 0 : 1);
+        ring.reap([&](const io_uring_cqe& cqe) { deferred.push_back(cqe); });
+        ready.swap(deferred);
+        for (const io_uring_cqe& cqe : ready) dispatch(cqe);
+        ready.clear();
+        if (!recv_armed) arm_recv();
+        stats.send_syscalls += ring.enters - counted_enters;
+        counted_enters = ring.enters;
+    }
+};
+
+void set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        handle_error("fcntl(O_NONBLOCK) failed");
     }
-    stat_file << "\n";
-    stat_file.close();
 }
 
-void stop_and_wait_sender(const string& receiver_ip, int total_packets) {
+// Event-driven transfer loop shared by all three protocols; they differ only
+// in window size. It sends one stripe, the seq range [first_seq, end_seq)
+// of the transfer, as its own session on its own socket. The socket is
+// non-blocking: the loop sends whenever the window has room, drains every
+// queued ACK when the socket is readable and fires per-packet
+// retransmission timers when the timerfd expires. Nothing on the data path
+// sleeps.
+void run_stripe(Protocol protocol, const sockaddr_in& server_addr, int window_size,
+                PacingMode pacing, double pace_bytes_per_sec, StripeResult& result,
+                TransferProgress& progress) {
     int sock = create_udp_socket();
-    configure_socket_timeout(sock, TIMEOUT);
+    bool use_uring = options.backend == BACKEND_IO_URING;
     
-    TransmissionStats stats = {0, 0, 0};
-    const int WINDOW_SIZE = 1;  // Stop-and-Wait uses window size of 1
-    int base = 0, next_seq_num = 0;
-    vector<bool> ack_received(total_packets, false);
-    vector<int> lost_packets;
-    
-    sockaddr_in server_addr{};
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(PORT);
-    if (inet_pton(AF_INET, receiver_ip.c_str(), &server_addr.sin_addr) <= 0) {
-        handle_error("Invalid receiver IP address");
+    TransmissionStats& stats = result.stats;
+    const uint32_t conn_id = result.conn_id;
+    uint32_t base = result.first_seq, next_seq_num = result.first_seq;
+    const uint32_t end_seq = result.end_seq;  // One past the last packet
+    int peer_window = INT_MAX;  // Receiver's advertised buffer, from the latest ACK
+    vector<uint32_t>& lost_packets = result.lost_packets;
+
+    // Payloads are sent straight from the file mapping (or the shared test
+    // payload); the ring only holds headers and state for the window
+    bool file_mode = input_file.is_open();
+    RetransmitState retransmit(window_size);
+    unique_ptr<CongestionController> cc = make_congestion_controller(options.cc, window_size);
+    unique_ptr<FecEncoder> fec;
+    if (options.fec_block > 0) fec.reset(new FecEncoder(conn_id, result.first_seq, end_seq, window_size));
+    const uint64_t start_us = now_us();
+    auto trace_cwnd = [&](bool force) {
+        if (cc) result.cwnd_trace.record(now_us() - start_us, cc->window(), force);
+    };
+    trace_cwnd(true);
+
+    // With --window=auto window_size only sizes the ring, and the tuner
+    // decides how much of it is used. Either way the receiver's buffer caps it.
+    unique_ptr<WindowTuner> tuner;
+    if (options.auto_window) tuner.reset(new WindowTuner(window_size));
+    auto flow_window = [&]() { return min(tuner ? tuner->current() : window_size, peer_window); };
+    auto trace_window = [&](bool force) {
+        if (tuner) result.window_trace.record(now_us() - start_us, tuner->current(), force);
+    };
+    trace_window(true);
+
+    // Paced at a fixed share of --pace, or with --pace=auto at a gain over
+    // the rate the window and RTT allow, updated on every ACK
+    Pacer pacer(pacing, sock);
+    pacer.set_rate(pace_bytes_per_sec);
+    result.pacing = pacer.current_mode();
+    auto update_pacing_rate = [&]() {
+        uint64_t srtt_us = retransmit.rtt.srtt_us();
+        if (!options.pace_auto || srtt_us == 0) return;
+        double packets = cc ? min<double>(cc->window(), flow_window()) : flow_window();
+        double gain = cc && cc->in_slow_start() ? PACING_GAIN_SLOW_START : PACING_GAIN;
+        pacer.set_rate(gain * packets * PACKET_SIZE * 1e6 / srtt_us);
+    };
+
+    // The socket backend multiplexes a non-blocking socket and a timerfd with
+    // epoll. The io_uring backend keeps the socket blocking and lets the ring
+    // wait for send space, ACKs and the RTO instead.
+    unique_ptr<UringSender> uring;
+    int tfd = -1, epfd = -1;
+    epoll_event sock_event{};
+    if (use_uring) {
+        uring.reset(new UringSender(sock, conn_id));
+    } else {
+        set_nonblocking(sock);
+        tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        epfd = epoll_create1(0);
+        if (tfd < 0 || epfd < 0) {
+            handle_error("timerfd/epoll setup failed");
+        }
+        sock_event.events = EPOLLIN;
+        sock_event.data.fd = sock;
+        epoll_event timer_event{};
+        timer_event.events = EPOLLIN;
+        timer_event.data.fd = tfd;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, sock, &sock_event) < 0 ||
+            epoll_ctl(epfd, EPOLL_CTL_ADD, tfd, &timer_event) < 0) {
+            handle_error("epoll_ctl failed");
+        }
     }
 
-    AdaptiveTimeout timeout;
-    PacketBuffer packet_buffer(total_packets);
+    // Waiting for EPOLLOUT after the socket buffer filled up
+    bool write_blocked = false;
+    auto set_write_blocked = [&](bool blocked) {
+        if (blocked == write_blocked) return;
+        write_blocked = blocked;
+        sock_event.events = blocked ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        epoll_ctl(epfd, EPOLL_CTL_MOD, sock, &sock_event);
+    };
+
+    // Everything that becomes eligible in one loop iteration goes out in as
+    // few sendmmsg() calls (or one io_uring submission) as the batch size allows
+    TxBatch batch(options.batch_size, server_addr, options.gso ? PACKET_SIZE : 0);
+    auto flush_batch = [&]() {
+        if (uring) {
+            uring->send(batch, stats);
+        } else {
+            set_write_blocked(!batch.flush(sock, stats));
+        }
+    };
+    // Serializes a new packet into its pool buffer once: header and test
+    // payload together, or just the header in front of a file slice that
+    // stays in the mapping. Retransmissions only patch the attempt field.
+    // The first packet carries SYN so the receiver knows where the stripe
+    // starts, the last one FIN so it knows where the data ends.
+    auto fill_slot = [&](uint32_t seq) -> SendSlot& {
+        SendSlot& slot = retransmit.claim(seq);
+        char* buffer = retransmit.ring.buffer(seq);
+        size_t len;
+        if (file_mode) {
+            slot.payload = input_file.slice(seq, len);
+        } else {
+            len = test_payload().size();
+            memcpy(buffer + HEADER_SIZE, test_payload().data(), len);
+            slot.payload = buffer + HEADER_SIZE;
+        }
+        slot.payload_len = len;
+        uint8_t flags = FLAG_DATA;
+        if (seq == result.first_seq) flags |= FLAG_SYN;
+        if (seq == end_seq - 1) flags |= FLAG_FIN;
+        if (fec) flags |= FLAG_FEC;
+        slot.payload_crc = encode_header(buffer, conn_id, seq, slot.payload, len, flags);
+        return slot;
+    };
+    // Hands the pool buffer to the batch by reference
+    auto queue_packet = [&](uint32_t seq) {
+        const SendSlot& slot = retransmit.ring[seq];
+        char* buffer = retransmit.ring.buffer(seq);
+        uint64_t txtime = pacer.on_send(HEADER_SIZE + slot.payload_len, now_us());
+        if (file_mode) {
+            batch.add(buffer, HEADER_SIZE, slot.payload, slot.payload_len, txtime);
+        } else {
+            batch.add(buffer, HEADER_SIZE + slot.payload_len, nullptr, 0, txtime);
+        }
+        if (batch.full()) flush_batch();
+    };
+    // A finished FEC block's repair packets, straight behind it. They take
+    // their chances with loss like any packet, and are dropped rather than
+    // waited for when the socket buffer is full.
+    auto send_repairs = [&]() {
+        stats.fec_blocks++;
+        for (int j = 0; j < fec->current_repairs(); j++) {
+            size_t len;
+            const char* packet = fec->repair(j, len);
+            stats.repair_packets++;
+            if (simulate_packet_loss() || batch.full()) continue;
+            batch.add(packet, len, nullptr, 0, pacer.on_send(len, now_us()));
+            if (batch.full()) flush_batch();
+        }
+    };
+
+    // Queues one packet for resending, on its timer or ahead of it; false
+    // if the socket buffer is full
+    auto resend = [&](uint32_t seq, bool fast) {
+        if (write_blocked) return false;
+        const SendSlot& slot = retransmit.ring[seq];
+        patch_attempt(retransmit.ring.buffer(seq), slot.payload_crc, slot.retries + 1);
+        queue_packet(seq);
+        if (options.verbose) {
+            cout << "[Sender] " << (fast ? "Fast retransmit" : "Timeout") << ". Resent: " << seq << "\n";
+        }
+        stats.retransmissions++;
+        (fast ? stats.fast_retransmits : stats.timeout_retransmits)++;
+        // Go-Back-N always goes back from base, once per window
+        if (protocol != GO_BACK_N || seq == base) {
+            stats.recoveries++;
+            if (fast) stats.fast_recoveries++;
+        }
+        return true;
+    };
+
+    // The stripe gives up once the oldest outstanding packet has timed out
+    // again after MAX_RETRIES backed-off resends without base moving: the
+    // receiver is gone or the path is down, and nothing more gets through.
+    bool gave_up = false;
+    // Go-Back-N's window resends each cover every packet sent so far, so
+    // duplicate ACKs for anything below recover (next_seq_num at the latest
+    // resend) only echo the gap that resend already fills (RFC 6582).
+    uint32_t recover = base;
+    auto on_timeout = [&](TimerNode& node) {
+        uint32_t seq = node.seq_num;
+        if (gave_up || retransmit.ring[seq].acked || retransmit.defer(retransmit.ring[seq])) return;
+        if (seq == base && retransmit.backoffs >= MAX_RETRIES) {
+            gave_up = true;
+            return;
+        }
+        if (cc) {
+            bool new_event = seq == base ? cc->on_timeout(seq, next_seq_num)
+                                         : cc->on_loss(seq, next_seq_num);
+            if (new_event) stats.congestion_events++;
+            trace_cwnd(new_event);
+        }
+        // A Go-Back-N receiver discards everything after a gap, so the whole
+        // window from base goes again; the other protocols resend just this packet.
+        uint32_t first = protocol == GO_BACK_N ? base : seq;
+        uint32_t last = protocol == GO_BACK_N ? next_seq_num : seq + 1;
+        if (protocol == GO_BACK_N) recover = next_seq_num;
+        for (uint32_t s = first; s != last; s++) {
+            SendSlot& slot = retransmit.ring[s];
+            if (slot.acked) continue;
+            if (!resend(s, false)) {
+                retransmit.timers.arm(slot.timer, now_us() + TIMER_TICK_US);  // Try again shortly
+                break;
+            }
+            retransmit.on_retransmitted(slot, s == base);
+        }
+    };
 
-    auto timeout_handler = [&]() {
-        while(is_running && base < total_packets) {
-            this_thread::sleep_for(chrono::milliseconds(timeout.get()));
-            if (base < next_seq_num && !ack_received[base]) {
-                string packet = packet_buffer.get(base);
-                if (sendto(sock, packet.c_str(), packet.size(), 0, 
-                          (sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-                    timeout.increase();
-                } else {
-                    stats.retransmissions++;
+    // Fast retransmit: a packet is presumed lost once DUPACK_THRESHOLD
+    // packets sent after it are acked, and is resent at once instead of at
+    // its RTO, with a fast-recovery cwnd reduction rather than a reset.
+    // Selective Repeat reads that off the SACK bitmap (forward
+    // acknowledgement: everything that far below the highest acked packet)
+    // and resends each hole once; fast_next is where the holes not yet
+    // resent start. A Go-Back-N receiver has no SACK, but acks every packet
+    // past a gap with the same cum_ack, so the window from base goes again
+    // on the third duplicate ACK, once per recovery episode: not before
+    // cum_ack has reached recover.
+    //
+    // With FEC a hole is first left to its block's repair packets: it only
+    // counts as lost once DUPACK_THRESHOLD packets past the end of its block
+    // are acked, which the ACK the receiver sends on rebuilding it beats,
+    // or once its finished block shows more holes than it had repairs. A
+    // block the window (or the end of the stripe) leaves no room to send
+    // that far past is not waited for.
+    // The holes are also counted, ungated, for the FEC loss estimate.
+    uint32_t fast_next = base;
+    uint32_t hole_scan = base;
+    int dup_acks = 0;
+    auto fast_retransmit = [&](uint32_t first, uint32_t last) {
+        bool started = false;
+        uint32_t s = first;
+        for (; s != last; s++) {
+            SendSlot& slot = retransmit.ring[s];
+            if (slot.acked) continue;
+            if (!started && cc) {
+                bool new_event = cc->on_loss(s, next_seq_num);
+                if (new_event) stats.congestion_events++;
+                trace_cwnd(new_event);
+            }
+            started = true;
+            if (!resend(s, true)) break;  // The timer still covers the rest
+            retransmit.on_retransmitted(slot, false);
+        }
+        return s;
+    };
+    auto detect_losses = [&](const AckInfo& ack, int newly_acked) {
+        if (protocol == SELECTIVE_REPEAT) {
+            uint32_t edge = ack_forward_edge(ack);
+            if (seq_before(next_seq_num, edge)) edge = next_seq_num;
+            if (seq_before(fast_next, base)) fast_next = base;
+            uint32_t limit = edge - DUPACK_THRESHOLD;
+            if (fec) {
+                if (seq_before(hole_scan, base)) hole_scan = base;
+                int holes = 0;
+                for (; seq_before(hole_scan, limit); hole_scan++) {
+                    if (!retransmit.ring[hole_scan].acked) holes++;
+                }
+                fec->on_holes(holes);
+                uint32_t gate = fec->block_start(limit);
+                if (seq_before(fast_next, limit) && seq_before(gate, limit)) {
+                    uint32_t block_end = fec->block_end(gate);
+                    uint32_t scan_end = seq_before(edge, block_end) ? edge : block_end;
+                    int block_holes = 0;
+                    for (uint32_t s = seq_before(gate, base) ? base : gate; seq_before(s, scan_end); s++) {
+                        if (!retransmit.ring[s].acked) block_holes++;
+                    }
+                    bool repairable = seq_before(next_seq_num, block_end) ||
+                                      block_holes <= fec->repairs_for(gate);
+                    int reach = flow_window();
+                    if (cc) reach = min(reach, max(static_cast<int>(cc->window()), 1));
+                    bool followed = seq_diff(end_seq, block_end) >= DUPACK_THRESHOLD &&
+                                    seq_diff(block_end, base) + DUPACK_THRESHOLD <= reach;
+                    if (repairable && followed) limit = gate;
                 }
             }
+            if (seq_before(fast_next, limit)) fast_next = fast_retransmit(fast_next, limit);
+        } else if (protocol == GO_BACK_N) {
+            if (newly_acked > 0 || ack.cum_ack != base || base == next_seq_num) {
+                dup_acks = 0;
+            } else if (++dup_acks == DUPACK_THRESHOLD && !seq_before(ack.cum_ack, recover)) {
+                recover = next_seq_num;
+                fast_retransmit(base, next_seq_num);
+            }
         }
     };
 
-    thread timeout_thread(timeout_handler);
+    auto on_ack = [&](const AckInfo& ack) {
+        if (options.verbose) {
+            cout << "[Sender] ACK received: " << ack.cum_ack
+                 << " (+" << ack.sack_words << " SACK words)\n";
+        }
+        peer_window = ack.window;
+        int newly_acked = retransmit.apply_ack(ack, base, next_seq_num, stats);
+        result.packets_acked += newly_acked;
+        progress.packets_acked += newly_acked;
+        if (tuner && tuner->on_ack(newly_acked, now_us(), retransmit.rtt.min_rtt_us())) trace_window(false);
+        if (cc) {
+            cc->on_ack(newly_acked, base, now_us(), retransmit.rtt.srtt_us());
+            trace_cwnd(false);
+        }
+        detect_losses(ack, newly_acked);
+        update_pacing_rate();
+    };
 
-    while (base < total_packets) {
-        // Send packet if within window (window size = 1)
-        if (can_send(next_seq_num, base, WINDOW_SIZE) && next_seq_num < total_packets) {
-            string packet = create_packet(next_seq_num);
-            packet_buffer.store(next_seq_num, packet);
+    while (base != end_seq && !gave_up) {
+        // Send packets within window. The SYN packet goes alone: the receiver
+        // refuses everything until it has it, and its ACK is a clean first
+        // RTT sample.
+        int window = base == result.first_seq ? 1 : flow_window();
+        double cwnd = cc ? cc->window() : window;
+        bool paced = false;  // Held back by the user-space pacer
+        while (!write_blocked && next_seq_num != end_seq && can_send(next_seq_num, base, window, cwnd)) {
+            uint64_t sent_us = now_us();
+            if (!pacer.ready(sent_us)) {
+                paced = true;
+                break;
+            }
+            SendSlot& slot = fill_slot(next_seq_num);
             
             if (!simulate_packet_loss()) {
-                if (sendto(sock, packet.c_str(), packet.size(), 0, 
-                          (sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-                    cerr << "[ERROR] Failed to send packet " << next_seq_num << "\n";
-                    continue;
+                queue_packet(next_seq_num);
+                if (options.verbose) {
+                    cout << "[SENT] Packet " << next_seq_num << " | Window base: " << base << "\n";
                 }
-                cout << "[SENT] Packet " << next_seq_num << " | Window base: " << base << "\n";
                 stats.packets_sent++;
             } else {
-                cout << "[LOST] Packet " << next_seq_num << " lost in transmission\n";
+                if (options.verbose) cout << "[LOST] Packet " << next_seq_num << " lost in transmission\n";
+                pacer.on_send(HEADER_SIZE + slot.payload_len, sent_us);  // Lost on the way, not at home
                 stats.packets_lost++;
-                lost_packets.push_back(next_seq_num);
+                if (lost_packets.size() < MAX_LOGGED_LOSSES) lost_packets.push_back(next_seq_num);
+            }
+            if (fec && fec->add(next_seq_num, slot.payload, slot.payload_len, next_seq_num == end_seq - 1)) {
+                send_repairs();
             }
+            retransmit.on_sent(slot, sent_us);
             next_seq_num++;
         }
+        if (!write_blocked) flush_batch();
 
-        // Handle ACK
-        char buffer[1024] = {0};
-        sockaddr_in recv_addr{};
-        socklen_t addr_len = sizeof(recv_addr);
-        
-        int bytes_received = recvfrom(sock, buffer, sizeof(buffer), 0, 
-                                    (sockaddr*)&recv_addr, &addr_len);
+        uint64_t wake_us = retransmit.timers.empty() ? 0 : retransmit.timers.next_wakeup_us();
+        if (paced) wake_us = earliest_wakeup(wake_us, pacer.next_departure_us());
+        if (uring) {
+            uring->arm_timeout(wake_us);
+            uring->wait(stats, on_ack, [&]() {
+                retransmit.timers.advance(now_us(), on_timeout);
+            });
+            flush_batch();
+            continue;
+        }
 
-        if (bytes_received > 0) {
-            try {
-                int ack = stoi(buffer);
-                cout << "[Sender] ACK received: " << ack << "\n";
-                if (ack == base) {
-                    ack_received[ack] = true;
-                    base++;  // Slide the window
+        arm_timerfd(tfd, wake_us);
+
+        epoll_event events[4];
+        int ready = epoll_wait(epfd, events, 4, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            handle_error("epoll_wait failed");
+        }
+        for (int i = 0; i < ready; i++) {
+            if (events[i].data.fd == sock) {
+                if (events[i].events & EPOLLOUT) flush_batch();
+                if (events[i].events & EPOLLIN) {
+                    drain_acks(sock, conn_id, on_ack);
+                    // Out before the send loop can recycle the slot of a
+                    // resent packet that a later ACK in the drain covered
+                    if (!write_blocked) flush_batch();
                 }
-            } catch (const exception& e) {
-                cerr << "[Sender] Invalid ACK received\n";
+            } else {
+                uint64_t expirations;
+                while (read(tfd, &expirations, sizeof(expirations)) > 0) {}
+                // ACKs that arrived while the process was not running go
+                // first, or the timers they settle would resend for nothing
+                drain_acks(sock, conn_id, on_ack);
+                retransmit.timers.advance(now_us(), on_timeout);
+                if (!write_blocked) flush_batch();
             }
         }
-        
-        this_thread::sleep_for(chrono::milliseconds(100));
     }
 
-    is_running = false;
-    timeout_thread.join();
+    if (epfd >= 0) close(epfd);
+    if (tfd >= 0) close(tfd);
+    uring.reset();
     close(sock);
-    stats.print();
-    log_statistics(stats, total_packets, 1, ack_received, lost_packets);
-    cout << "[Sender] Transmission completed\n";
+    if (cc) {
+        trace_cwnd(true);
+        stats.final_cwnd = cc->window();
+    }
+    if (tuner) {
+        trace_window(true);
+        stats.final_window = tuner->current();
+        stats.delivery_rate_mbps = tuner->bandwidth() * PACKET_SIZE * 8 / 1e6;
+        stats.min_rtt_us = retransmit.rtt.min_rtt_us();
+    }
+    stats.pacing_rate_mbps = pacer.rate_mbps();
+    if (gave_up) {
+        cerr << "[Sender] No ACK for packet " << base << " after " << MAX_RETRIES
+             << " retransmissions, giving up\n";
+    } else {
+        progress.stripes_left--;
+    }
 }
 
-void selective_repeat_sender(const string& receiver_ip, int total_packets, int window_size) {
-    int sock = create_udp_socket();
-    configure_socket_timeout(sock, TIMEOUT);
-    
-    TransmissionStats stats = {0, 0, 0};
-    int base = 0, next_seq_num = 0;
-    vector<bool> ack_received(total_packets, false);
-    vector<int> lost_packets;
-    
+void pin_to_cpu(unsigned cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// --loss-check, for a path where the simulated losses are the only ones,
+// such as loopback. Every lost packet should then cost one recovery (one
+// resend, or one window resend with Go-Back-N), fast or on timeout, and
+// anything beyond that, give or take a few scheduling hiccups, is a
+// spurious retransmission.
+bool passes_loss_check(const TransmissionStats& stats) {
+    int allowed = static_cast<int>(LOSS_CHECK_RATIO * stats.packets_lost) + LOSS_CHECK_SLACK;
+    if (stats.recoveries <= allowed) return true;
+    cerr << "[Sender] Loss check failed: " << stats.recoveries << " recoveries ("
+         << stats.fast_recoveries << " fast) for " << stats.packets_lost
+         << " lost packets (at most " << allowed << " allowed)\n";
+    return false;
+}
+
+// Sends the transfer over --stripes sockets at once. Each stripe is a
+// contiguous slice of the sequence space with its own session, window share,
+// thread and socket (so its own source port), and the receiver puts the
+// slices back together by offset. The stripes' statistics are merged at the end.
+void run_transfer(Protocol protocol, const string& receiver_ip, int total_packets, int window_size) {
     sockaddr_in server_addr{};
     server_addr.sin_family = AF_INET;
     server_addr.sin_port = htons(PORT);
     if (inet_pton(AF_INET, receiver_ip.c_str(), &server_addr.sin_addr) <= 0) {
         handle_error("Invalid receiver IP address");
     }
-
-    AdaptiveTimeout timeout;
-    PacketBuffer packet_buffer(total_packets);
-
-    auto timeout_handler = [&]() {
-        while(is_running) {
-            this_thread::sleep_for(chrono::milliseconds(timeout.get()));
-            for (int i = base; i < min(next_seq_num, base + window_size); i++) {
-                if (!ack_received[i]) {
-                    cout << "[Sender] Timeout. Resending packet " << i << "\n";
-                    string packet = packet_buffer.get(i);
-                    sendto(sock, packet.c_str(), packet.size(), 0, 
-                           (sockaddr*)&server_addr, sizeof(server_addr));
-                    stats.retransmissions++;
-                }
-            }
+    // Settled before any stripe starts, they all read it
+    if (options.gso) {
+        int probe = create_udp_socket();
+        if (!gso_supported(probe)) {
+            cerr << "[Sender] UDP_SEGMENT not supported, sending datagrams individually\n";
+            options.gso = false;
         }
-    };
+        close(probe);
+    }
 
-    thread timeout_thread(timeout_handler);
+    // Only a Selective Repeat receiver keeps what arrives past a gap, which
+    // is what a repair packet is combined with
+    if (options.fec_block > 0 && protocol != SELECTIVE_REPEAT) {
+        cerr << "[Sender] FEC needs Selective Repeat, sending without repair packets\n";
+        options.fec_block = 0;
+    }
+    if (options.fec_block > 0) {
+        cout << "[Sender] FEC blocks of " << options.fec_block << " packets, ";
+        if (options.fec_repairs > 0) cout << options.fec_repairs << " repair packets each";
+        else cout << "repair packets following the loss rate";
+        cout << " (" << gf_engine.name << ")\n";
+    }
 
-    while (base < total_packets) {
-        if (can_send(next_seq_num, base, window_size) && next_seq_num < total_packets) {
-            string packet = create_packet(next_seq_num);
-            packet_buffer.store(next_seq_num, packet);
-            
-            if (!simulate_packet_loss()) {
-                if (sendto(sock, packet.c_str(), packet.size(), 0, 
-                          (sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-                    cerr << "[ERROR] Failed to send packet " << next_seq_num << "\n";
-                    continue;
-                }
-                cout << "[SENT] Packet " << next_seq_num << " | Window base: " << base << "\n";
-                stats.packets_sent++;
-            } else {
-                cout << "[LOST] Packet " << next_seq_num << " lost in transmission\n";
-                stats.packets_lost++;
-                lost_packets.push_back(next_seq_num);
-            }
-            next_seq_num++;
-        }
+    int stripe_count = min(options.stripes, total_packets);
+    int stripe_window = max(window_size / stripe_count, 1);
+    vector<StripeResult> stripes(stripe_count);
+    for (int i = 0; i < stripe_count; i++) {
+        stripes[i].conn_id = stripe_conn_id(connection_id, stripe_count, i);
+        stripes[i].first_seq = uint64_t(total_packets) * i / stripe_count;
+        stripes[i].end_seq = uint64_t(total_packets) * (i + 1) / stripe_count;
+    }
+    TransferProgress progress(stripe_count);
 
-        char buffer[1024] = {0};
-        sockaddr_in recv_addr{};
-        socklen_t addr_len = sizeof(recv_addr);
-        
-        int bytes_received = recvfrom(sock, buffer, sizeof(buffer), 0, 
-                                    (sockaddr*)&recv_addr, &addr_len);
+    // Likewise the pacing mechanism (txtime_clock included). A fixed rate is
+    // split evenly between the stripes.
+    PacingMode pacing = PACING_OFF;
+    double stripe_rate = options.pace_mbps * 1e6 / 8 / stripe_count;  // Bytes/s
+    if (options.pace_mbps > 0 || options.pace_auto) {
+        pacing = options.pacer != PACING_OFF ? options.pacer : detect_pacing(server_addr);
+        cout << "[Sender] Pacing with " << PACING_MODE_NAMES[pacing];
+        if (options.pace_auto) {
+            cout << " at " << (options.cc != CC_NONE ? "cwnd" : "window") << " / srtt\n";
+        } else {
+            cout << " at " << options.pace_mbps << " Mbit/s\n";
+        }
+    }
 
-        if (bytes_received > 0) {
-            try {
-                int ack = stoi(buffer);
-                cout << "[Sender] ACK received: " << ack << "\n";
-                ack_received[ack] = true;
-                
-                // Move base if possible
-                while (base < total_packets && ack_received[base]) {
-                    base++;
-                }
-            } catch (const exception& e) {
-                cerr << "[Sender] Invalid ACK received\n";
-            }
+    if (stripe_count == 1) {
+        run_stripe(protocol, server_addr, stripe_window, pacing, stripe_rate, stripes[0], progress);
+    } else {
+        cout << "[Sender] Striping over " << stripe_count << " sockets, window "
+             << (options.auto_window ? "auto, up to " : "") << stripe_window << " each\n";
+        vector<thread> workers;
+        unsigned cpus = max(thread::hardware_concurrency(), 1u);
+        for (int i = 0; i < stripe_count; i++) {
+            workers.emplace_back([&, i]() {
+                pin_to_cpu(i % cpus);
+                run_stripe(protocol, server_addr, stripe_window, pacing, stripe_rate, stripes[i], progress);
+            });
         }
-        
-        this_thread::sleep_for(chrono::milliseconds(100));
+        for (thread& worker : workers) worker.join();
     }
 
-    is_running = false;
-    timeout_thread.join();
-    close(sock);
+    TransmissionStats stats;
+    vector<uint32_t> lost_packets;
+    for (int i = 0; i < stripe_count; i++) {
+        const StripeResult& stripe = stripes[i];
+        if (stripe_count > 1) stripe.stats.print("Stripe " + to_string(i));
+        stats.merge(stripe.stats);
+        for (uint32_t seq : stripe.lost_packets) {
+            if (lost_packets.size() < MAX_LOGGED_LOSSES) lost_packets.push_back(seq);
+        }
+    }
     stats.print();
-    log_statistics(stats, total_packets, window_size, ack_received, lost_packets);
-    cout << "[Sender] Transmission completed\n";
+    log_statistics(stats, total_packets, window_size, progress.packets_acked, lost_packets, stripes);
+    if (options.loss_check && !passes_loss_check(stats)) exit(1);
+    if (progress.complete()) {
+        cout << "[Sender] Transmission completed\n";
+    } else {
+        cout << "[Sender] Transmission incomplete: " << progress.packets_acked << "/"
+             << total_packets << " packets acknowledged\n";
+    }
+}
+
+void stop_and_wait_sender(const string& receiver_ip, int total_packets) {
+    run_transfer(STOP_AND_WAIT, receiver_ip, total_packets, 1);  // Stop-and-Wait uses window size of 1
+}
+
+void selective_repeat_sender(const string& receiver_ip, int total_packets, int window_size) {
+    run_transfer(SELECTIVE_REPEAT, receiver_ip, total_packets, window_size);
 }
 
 void sender(Protocol protocol, const string& receiver_ip, int w_size, int t_packets) {
     if (protocol == STOP_AND_WAIT) {
         stop_and_wait_sender(receiver_ip, t_packets);
     } else if (protocol == GO_BACK_N) {
-        // Original Go-Back-N implementation
-        int sock = create_udp_socket();
-        configure_socket_timeout(sock, TIMEOUT);
-        
-        TransmissionStats stats = {0, 0, 0};
-        
-        int WINDOW_SIZE = w_size;
-        int TOTAL_PACKETS = t_packets;
-        int base = 0, next_seq_num = 0;
-        vector<bool> ack_received(TOTAL_PACKETS, false);
-        vector<int> lost_packets;
-
-        sockaddr_in server_addr{};
-        server_addr.sin_family = AF_INET;
-        server_addr.sin_port = htons(PORT);
-        if (inet_pton(AF_INET, receiver_ip.c_str(), &server_addr.sin_addr) <= 0) {
-            handle_error("Invalid receiver IP address");
-        }
-
-        AdaptiveTimeout timeout;
-        PacketBuffer packet_buffer(TOTAL_PACKETS);
-
-        auto timeout_handler = [&]() {
-            while(is_running) {
-                this_thread::sleep_for(chrono::milliseconds(timeout.get()));
-                if (base < next_seq_num) {
-                    cout << "[Sender] Timeout. Resending from " << base << " to " << next_seq_num-1 << "\n";
-                    for (int i = base; i < next_seq_num; i++) {
-                        if (!ack_received[i]) {
-                            string packet = packet_buffer.get(i);
-                            sendto(sock, packet.c_str(), packet.size(), 0, 
-                                   (sockaddr*)&server_addr, sizeof(server_addr));
-                            cout << "[Sender] Resent: " << i << "\n";
-                        }
-                    }
-                }
-            }
-        };
+        run_transfer(GO_BACK_N, receiver_ip, t_packets, w_size);
+    } else {
+        selective_repeat_sender(receiver_ip, t_packets, w_size);
+    }
+}
 
-        thread timeout_thread(timeout_handler);
-
-        while (base < TOTAL_PACKETS) {
-            // Send packets within window
-            while (can_send(next_seq_num, base, WINDOW_SIZE) && next_seq_num < TOTAL_PACKETS) {
-                string packet = create_packet(next_seq_num);
-                packet_buffer.store(next_seq_num, packet);
-                
-                if (!simulate_packet_loss()) {
-                    if (sendto(sock, packet.c_str(), packet.size(), 0, 
-                              (sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-                        cerr << "[ERROR] Failed to send packet " << next_seq_num << "\n";
-                        continue;
-                    }
-                    cout << "[SENT] Packet " << next_seq_num << " | Window base: " << base << "\n";
-                    stats.packets_sent++;
-                } else {
-                    cout << "[LOST] Packet " << next_seq_num << " lost in transmission\n";
-                    stats.packets_lost++;
-                    lost_packets.push_back(next_seq_num);
-                }
-                
-                next_seq_num++;
-                this_thread::sleep_for(chrono::milliseconds(100));
+// Measures single-core throughput of every checksum engine the CPU supports
+void run_checksum_benchmark() {
+    const size_t sizes[] = {64, MAX_PAYLOAD_SIZE, 9000, 65536};
+    vector<unsigned char> data(65536);
+    mt19937 gen(42);
+    for (auto& b : data) b = static_cast<unsigned char>(gen());
+
+    cout << "=== Checksum Benchmark (single core) ===\n";
+    for (const ChecksumEngine& engine : available_checksum_engines()) {
+        for (size_t size : sizes) {
+            const size_t total_bytes = size_t(1) << 30;
+            size_t iterations = total_bytes / size;
+            uint32_t crc = 0;
+            auto start = chrono::steady_clock::now();
+            for (size_t i = 0; i < iterations; i++) {
+                crc = engine.update(crc, data.data(), size);
             }
+            double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            cout << engine.name << " | " << size << " bytes: "
+                 << (iterations * size) / secs / 1e9 << " GB/s"
+                 << " (crc " << hex << crc << dec << ")\n";
+        }
+    }
+}
 
-            // Handle ACKs
-            char buffer[1024] = {0};
-            sockaddr_in recv_addr{};
-            socklen_t addr_len = sizeof(recv_addr);
-            
-            int bytes_received = recvfrom(sock, buffer, sizeof(buffer), 0, 
-                                        (sockaddr*)&recv_addr, &addr_len);
-
-            if (bytes_received > 0) {
-                try {
-                    int ack = stoi(buffer);
-                    cout << "[Sender] ACK received: " << ack << "\n";
-                    if (ack >= base) {
-                        ack_received[ack] = true;
-                        while (base < TOTAL_PACKETS && ack_received[base]) {
-                            base++;
-                        }
-                    }
-                } catch (const exception& e) {
-                    cerr << "[Sender] Invalid ACK received\n";
+void print_usage(const char* prog) {
+    cout << "Usage: " << prog << " <receiver_ip> [--quiet] [--batch=N] [--gso] [--backend=socket|io_uring]\n"
+         << "       [--file=PATH] [--huge-pages] [--stripes=K] [--cc=none|newreno|cubic]\n"
+         << "       [--pace=MBPS|auto] [--pacer=txtime|rate|user] [--fec=N[:K]] [--loss-check]\n"
+         << "       " << prog << " --bench-crc\n"
+         << "  --quiet      Suppress per-packet log lines\n"
+         << "  --batch=N    Datagrams per sendmmsg() call (default " << SenderOptions().batch_size << ")\n"
+         << "  --gso        Send full " << PACKET_SIZE << "-byte packets with UDP segmentation offload\n"
+         << "  --backend=B  Transport: socket (default) or io_uring\n"
+         << "  --file=PATH  Send the contents of PATH (memory-mapped) instead of test packets\n"
+         << "  --huge-pages Allocate the packet pool from huge pages\n"
+         << "  --stripes=K  Split the transfer over K sockets and threads (1-" << MAX_STRIPES
+         << "), the window shared among them\n"
+         << "  --cc=A       Congestion control: none (default, window only), newreno or cubic\n"
+         << "  --pace=R     Spread packets out at R Mbit/s, or with auto at the rate cwnd (or the\n"
+         << "               window) allows per RTT\n"
+         << "  --pacer=P    Pacing mechanism: txtime (SO_TXTIME), rate (SO_MAX_PACING_RATE) or\n"
+         << "               user (timer in the send loop); picked from the qdisc by default\n"
+         << "  --fec=N[:K]  Selective Repeat: follow every N data packets (up to " << FEC_MAX_DATA
+         << ") with K repair\n"
+         << "               packets (up to " << FEC_MAX_REPAIR << "), or as many as the loss rate calls for\n"
+         << "  --loss-check Exit with status 1 if retransmissions outrun the simulated losses\n"
+         << "               (for loopback runs, where those are the only losses)\n"
+         << "  --bench-crc  Measure checksum throughput and exit\n";
+}
+
+// Fills options and receiver_ip from argv. --key=value flags may appear in
+// any order around the receiver IP.
+bool parse_options(int argc, char* argv[], string& receiver_ip, bool& bench_crc) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            receiver_ip = arg;
+            continue;
+        }
+        size_t eq = arg.find('=');
+        string key = arg.substr(0, eq);
+        string value = eq == string::npos ? "" : arg.substr(eq + 1);
+        try {
+            if (key == "--quiet") {
+                options.verbose = false;
+            } else if (key == "--batch") {
+                options.batch_size = max(stoi(value), 1);
+            } else if (key == "--gso") {
+                options.gso = true;
+            } else if (key == "--backend" && (value == "socket" || value == "io_uring")) {
+                options.backend = value == "io_uring" ? BACKEND_IO_URING : BACKEND_SOCKET;
+            } else if (key == "--file" && !value.empty()) {
+                options.file = value;
+            } else if (key == "--huge-pages") {
+                options.huge_pages = true;
+            } else if (key == "--cc" && (value == "none" || value == "newreno" || value == "cubic")) {
+                options.cc = value == "newreno" ? CC_NEWRENO : value == "cubic" ? CC_CUBIC : CC_NONE;
+            } else if (key == "--pace" && value == "auto") {
+                options.pace_auto = true;
+            } else if (key == "--pace") {
+                options.pace_mbps = stod(value);
+                if (options.pace_mbps <= 0) return false;
+            } else if (key == "--pacer" && (value == "txtime" || value == "rate" || value == "user")) {
+                options.pacer = value == "txtime" ? PACING_TXTIME : value == "rate" ? PACING_RATE : PACING_USER;
+            } else if (key == "--stripes") {
+                options.stripes = min(max(stoi(value), 1), MAX_STRIPES);
+            } else if (key == "--fec") {
+                size_t colon = value.find(':');
+                options.fec_block = min(stoi(value.substr(0, colon)), FEC_MAX_DATA);
+                if (colon != string::npos) {
+                    options.fec_repairs = min(stoi(value.substr(colon + 1)), FEC_MAX_REPAIR);
+                    if (options.fec_repairs < 1) return false;
                 }
+                if (options.fec_block < 1) return false;
+            } else if (key == "--loss-check") {
+                options.loss_check = true;
+            } else if (key == "--bench-crc") {
+                bench_crc = true;
+            } else {
+                return false;
             }
+        } catch (const exception&) {
+            return false;
         }
-    stats.retransmissions = t_packets - stats.packets_sent;
-        is_running = false;
-        timeout_thread.join();
-        close(sock);
-        stats.print();
-        log_statistics(stats, t_packets, w_size, ack_received, lost_packets);
-        cout << "[Sender] Transmission completed\n";
-    } else {
-        selective_repeat_sender(receiver_ip, t_packets, w_size);
     }
+    return true;
 }
 
 int main(int argc, char* argv[]) {
-    // Add better IP handling
+    init_checksum();
+    init_fec();
+
     string receiver_ip;
-    if (argc < 2) {
-        cout << "Usage: " << argv[0] << " <receiver_ip>\n";
+    bool bench_crc = false;
+    if (!parse_options(argc, argv, receiver_ip, bench_crc)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (bench_crc) {
+        run_checksum_benchmark();
+        return 0;
+    }
+
+    // Add better IP handling
+    if (receiver_ip.empty()) {
+        print_usage(argv[0]);
         cout << "Enter receiver IP address: ";
         cin >> receiver_ip;
-    } else {
-        receiver_ip = argv[1];
     }
 
     // Verify IP address immediately
@@ -478,6 +2949,11 @@ int main(int argc, char* argv[]) {
     }
 
     cout << "Connecting to receiver at: " << receiver_ip << ":" << PORT << endl;
+    cout << "Checksum: " << checksum_engine.name << endl;
+    cout << "Congestion control: " << CONGESTION_ALGORITHM_NAMES[options.cc] << endl;
+
+    random_device rd;
+    connection_id = rd();
 
     int protocol_choice, WINDOW_SIZE = 1, TOTAL_PACKETS;
     
@@ -488,12 +2964,30 @@ int main(int argc, char* argv[]) {
     cout << "Enter choice (1-3): ";
     cin >> protocol_choice;
     
-    cout << "Enter Number of total packets: ";
-    cin >> TOTAL_PACKETS;
+    if (!options.file.empty()) {
+        input_file.open(options.file);
+        TOTAL_PACKETS = input_file.packet_count();
+        cout << "Sending " << options.file << " (" << input_file.bytes() << " bytes, "
+             << TOTAL_PACKETS << " packets)\n";
+    } else {
+        cout << "Enter Number of total packets: ";
+        cin >> TOTAL_PACKETS;
+    }
     
     if (protocol_choice > 1) {
-        cout << "Enter Window Size: ";
-        cin >> WINDOW_SIZE;
+        cout << "Enter Window Size (or auto): ";
+        string window;
+        cin >> window;
+        if (window == "auto") {
+            options.auto_window = true;
+            WINDOW_SIZE = AUTO_WINDOW_MAX;
+        } else {
+            try {
+                WINDOW_SIZE = stoi(window);
+            } catch (const exception&) {
+                WINDOW_SIZE = 0;
+            }
+        }
     }
     
     // Validate protocol choice
@@ -522,11 +3016,6 @@ int main(int argc, char* argv[]) {
         default: selected_protocol = STOP_AND_WAIT;
     }
     
-    sockaddr_in server_addr{};
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(PORT);
-    inet_pton(AF_INET, receiver_ip.c_str(), &server_addr.sin_addr);
-    
     sender(selected_protocol, receiver_ip, WINDOW_SIZE, TOTAL_PACKETS);
     
     return 0;